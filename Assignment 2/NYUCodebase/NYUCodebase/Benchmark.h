@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Matrix.h"
+#include "ShaderProgram.h"
+#include "SpriteBatch.h"
+#include "InstancedSpriteBatch.h"
+#include "RenderQueue.h"
+
+struct BenchmarkResult {
+    std::string name;
+    long long iterations;
+    double nsPerOp;
+    double opsPerSecond;
+    // for batched calls, how many items (points, angles) one op handles
+    int itemsPerOp;
+    double itemsPerSecond;
+    // vertex data one op streamed to GL, for the cases that measure it, else 0
+    double bytesPerOp;
+};
+
+// Runs small timed loops over the math and shader upload hot paths.
+// Every case gets warmupIterations untimed calls first, then iterations timed ones.
+class Benchmark {
+    public:
+    
+        Benchmark(long long warmupIterations, long long iterations);
+    
+        template <typename Function>
+        void Run(const std::string &name, Function function, int itemsPerOp = 1);
+    
+        void PrintResults() const;
+        bool WriteJSON(const char *filePath) const;
+    
+        long long warmupIterations;
+        long long iterations;
+        std::vector<BenchmarkResult> results;
+    
+        // written by the benchmark bodies so the optimizer can't drop their work
+        volatile float sink;
+};
+
+void RunMatrixBenchmarks(Benchmark &benchmark);
+// checks every multiply kernel the CPU has against MultiplyScalar, and that against double, on
+// identity, translation, projection, very large, very small and random matrices. Inverse and
+// InverseSSE go against InverseScalar on random and Translate/Roll/Scale matrices, with
+// M * M.Inverse() against identity and projective matrices kept off the affine path.
+// prints a line per check and the first few elements that are off, true when everything is in tolerance
+bool RunMatrixSelfTests();
+// needs a current GL context and a loaded program
+void RunShaderProgramBenchmarks(Benchmark &benchmark, ShaderProgram &program);
+// PNG decode to RGBA with the scalar and the SIMD unfilter paths. a decode is milliseconds,
+// so run it on a Benchmark with a lot fewer iterations than the others
+void RunImageDecodeBenchmarks(Benchmark &benchmark, const std::vector<std::string> &imageFiles);
+// whole frames of spriteCount sprites, one draw per sprite like SheetSprite::Draw against one
+// SpriteBatch, a packed SpriteBatch, and an InstancedSpriteBatch when instancedProgram is given.
+// with a ring the batches run again streaming through it, and report the bytes they streamed.
+// every op ends in glFinish, so this is milliseconds too
+void RunSpriteBenchmarks(Benchmark &benchmark, ShaderProgram &program, GLuint texture, int spriteCount, ShaderProgram *instancedProgram = NULL, VertexRing *ring = NULL);
+// spriteCount sprites alternating between two textures, the way sprites and text end up mixed in
+// a frame. a SpriteBatch in that order flushes on every sprite, the RenderQueue sorts them first
+void RunRenderQueueBenchmarks(Benchmark &benchmark, ShaderProgram &program, GLuint firstTexture, GLuint secondTexture, int spriteCount);
+
+template <typename Function>
+void Benchmark::Run(const std::string &name, Function function, int itemsPerOp) {
+    for(long long i = 0; i < warmupIterations; i++) {
+        function();
+    }
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(long long i = 0; i < iterations; i++) {
+        function();
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerOp = ns / (double)iterations;
+    result.opsPerSecond = result.nsPerOp > 0.0 ? 1.0e9 / result.nsPerOp : 0.0;
+    result.itemsPerOp = itemsPerOp;
+    result.itemsPerSecond = result.opsPerSecond * itemsPerOp;
+    result.bytesPerOp = 0.0;
+    results.push_back(result);
+}
@@ -0,0 +1,43 @@
+#include "CameraRect.h"
+
+CameraRect::CameraRect() : left(-1.0f), bottom(-1.0f), right(1.0f), top(1.0f), drawn(0), culled(0) {}
+
+void CameraRect::Set(const Matrix &viewMatrix, const Matrix &projectionMatrix) {
+    // the shaders do projection * view * position, so the corners of clip space go back through
+    // the inverse projection and then the inverse view. A rolled view gives a rotated rect, the
+    // bounds of all four corners cover it
+    Matrix inverseProjection = projectionMatrix.Inverse();
+    Matrix inverseView = viewMatrix.Inverse();
+    const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f } };
+    for(int i = 0; i < 4; i++) {
+        const Matrix &p = inverseProjection;
+        float eyeX = p.m[0][0] * corners[i][0] + p.m[1][0] * corners[i][1] + p.m[3][0];
+        float eyeY = p.m[0][1] * corners[i][0] + p.m[1][1] * corners[i][1] + p.m[3][1];
+        const Matrix &v = inverseView;
+        float worldX = v.m[0][0] * eyeX + v.m[1][0] * eyeY + v.m[3][0];
+        float worldY = v.m[0][1] * eyeX + v.m[1][1] * eyeY + v.m[3][1];
+        if(i == 0 || worldX < left) {
+            left = worldX;
+        }
+        if(i == 0 || worldX > right) {
+            right = worldX;
+        }
+        if(i == 0 || worldY < bottom) {
+            bottom = worldY;
+        }
+        if(i == 0 || worldY > top) {
+            top = worldY;
+        }
+    }
+    drawn = 0;
+    culled = 0;
+}
+
+bool CameraRect::Visible(float x, float y, float halfWidth, float halfHeight) {
+    if(x + halfWidth < left || x - halfWidth > right || y + halfHeight < bottom || y - halfHeight > top) {
+        culled++;
+        return false;
+    }
+    drawn++;
+    return true;
+}
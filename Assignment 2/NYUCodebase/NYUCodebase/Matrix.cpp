@@ -2,33 +2,64 @@
 #include "Matrix.h"
 #include <math.h>
 
-Matrix::Matrix() {
-    Identity();
-}
+#ifdef MATRIX_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
 
-void Matrix::Identity() {
-    m[0][0] = 1.0;
-    m[1][0] = 0.0;
-    m[2][0] = 0.0;
-    m[3][0] = 0.0;
-    
-    m[0][1] = 0.0;
-    m[1][1] = 1.0;
-    m[2][1] = 0.0;
-    m[3][1] = 0.0;
+Matrix Matrix::Inverse() const {
+    if(IsAffine()) {
+        return InverseAffine();
+    }
+#ifdef MATRIX_X86
+    static bool sse = HasSSE();
+    if(sse) {
+        return InverseSSE();
+    }
+#endif
+    return InverseScalar();
+}
 
-    m[0][2] = 0.0;
-    m[1][2] = 0.0;
-    m[2][2] = 1.0;
-    m[3][2] = 0.0;
+bool Matrix::IsAffine() const {
+    return m[0][3] == 0.0f && m[1][3] == 0.0f && m[2][3] == 0.0f && m[3][3] == 1.0f;
+}
 
-    m[0][3] = 0.0;
-    m[1][3] = 0.0;
-    m[2][3] = 0.0;
-    m[3][3] = 1.0;
+// inverts the upper 3x3 with cofactors and moves the translation back through it
+Matrix Matrix::InverseAffine() const {
+    float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    float c01 = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+    float c02 = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    float c10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    float c11 = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+    float c12 = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+    float c20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    float c21 = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+    float c22 = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    
+    float invDet = 1.0f / (m[0][0] * c00 + m[0][1] * c10 + m[0][2] * c20);
+    
+    Matrix m2;
+    m2.m[0][0] = c00 * invDet;
+    m2.m[0][1] = c01 * invDet;
+    m2.m[0][2] = c02 * invDet;
+    m2.m[1][0] = c10 * invDet;
+    m2.m[1][1] = c11 * invDet;
+    m2.m[1][2] = c12 * invDet;
+    m2.m[2][0] = c20 * invDet;
+    m2.m[2][1] = c21 * invDet;
+    m2.m[2][2] = c22 * invDet;
+    
+    m2.m[3][0] = -(m2.m[0][0] * m[3][0] + m2.m[1][0] * m[3][1] + m2.m[2][0] * m[3][2]);
+    m2.m[3][1] = -(m2.m[0][1] * m[3][0] + m2.m[1][1] * m[3][1] + m2.m[2][1] * m[3][2]);
+    m2.m[3][2] = -(m2.m[0][2] * m[3][0] + m2.m[1][2] * m[3][1] + m2.m[2][2] * m[3][2]);
+    return m2;
 }
 
-Matrix Matrix::Inverse() const {
+Matrix Matrix::InverseScalar() const {
     float m00 = m[0][0], m01 = m[0][1], m02 = m[0][2], m03 = m[0][3];
     float m10 = m[1][0], m11 = m[1][1], m12 = m[1][2], m13 = m[1][3];
     float m20 = m[2][0], m21 = m[2][1], m22 = m[2][2], m23 = m[2][3];
@@ -102,36 +133,213 @@ Matrix Matrix::Inverse() const {
     return m2;
 }
 
+#ifdef MATRIX_X86
+
+// cramer's rule on four columns at once, after the Intel SSE 4x4 inverse
+MATRIX_TARGET_SSE Matrix Matrix::InverseSSE() const {
+    __m128 minor0, minor1, minor2, minor3;
+    __m128 row0, row1, row2, row3;
+    __m128 det, tmp1;
+    
+    tmp1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(ml)), (const __m64 *)(ml + 4));
+    row1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(ml + 8)), (const __m64 *)(ml + 12));
+    row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
+    row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
+    tmp1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(ml + 2)), (const __m64 *)(ml + 6));
+    row3 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(ml + 10)), (const __m64 *)(ml + 14));
+    row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
+    row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
+    
+    tmp1 = _mm_mul_ps(row2, row3);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor0 = _mm_mul_ps(row1, tmp1);
+    minor1 = _mm_mul_ps(row0, tmp1);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp1), minor0);
+    minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor1);
+    minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+    
+    tmp1 = _mm_mul_ps(row1, row2);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor0);
+    minor3 = _mm_mul_ps(row0, tmp1);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp1));
+    minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor3);
+    minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+    
+    tmp1 = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    row2 = _mm_shuffle_ps(row2, row2, 0x4E);
+    minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor0);
+    minor2 = _mm_mul_ps(row0, tmp1);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp1));
+    minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor2);
+    minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+    
+    tmp1 = _mm_mul_ps(row0, row1);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor2);
+    minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp1), minor3);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp1), minor2);
+    minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp1));
+    
+    tmp1 = _mm_mul_ps(row0, row3);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp1));
+    minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor2);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor1);
+    minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp1));
+    
+    tmp1 = _mm_mul_ps(row0, row2);
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor1);
+    minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp1));
+    tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp1));
+    minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor3);
+    
+    // full precision divide instead of rcp so it matches the scalar path
+    det = _mm_mul_ps(row0, minor0);
+    det = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+    det = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
+    det = _mm_div_ss(_mm_set_ss(1.0f), det);
+    det = _mm_shuffle_ps(det, det, 0x00);
+    
+    Matrix m2;
+    _mm_storeu_ps(m2.ml, _mm_mul_ps(det, minor0));
+    _mm_storeu_ps(m2.ml + 4, _mm_mul_ps(det, minor1));
+    _mm_storeu_ps(m2.ml + 8, _mm_mul_ps(det, minor2));
+    _mm_storeu_ps(m2.ml + 12, _mm_mul_ps(det, minor3));
+    return m2;
+}
+
+#endif
+
 Matrix Matrix::operator * (const Matrix &m2) const {
+    static MultiplyFunction multiply = SelectMultiply();
     Matrix r;
+    multiply(*this, m2, r);
+    return r;
+}
+
+void Matrix::MultiplyScalar(const Matrix &a, const Matrix &b, Matrix &r) {
+    r.m[0][0] = a.m[0][0] * b.m[0][0] + a.m[0][1] * b.m[1][0] + a.m[0][2] * b.m[2][0] + a.m[0][3] * b.m[3][0];
+    r.m[0][1] = a.m[0][0] * b.m[0][1] + a.m[0][1] * b.m[1][1] + a.m[0][2] * b.m[2][1] + a.m[0][3] * b.m[3][1];
+    r.m[0][2] = a.m[0][0] * b.m[0][2] + a.m[0][1] * b.m[1][2] + a.m[0][2] * b.m[2][2] + a.m[0][3] * b.m[3][2];
+    r.m[0][3] = a.m[0][0] * b.m[0][3] + a.m[0][1] * b.m[1][3] + a.m[0][2] * b.m[2][3] + a.m[0][3] * b.m[3][3];
     
-    r.m[0][0] = m[0][0] * m2.m[0][0] + m[0][1] * m2.m[1][0] + m[0][2] * m2.m[2][0] + m[0][3] * m2.m[3][0];
-    r.m[0][1] = m[0][0] * m2.m[0][1] + m[0][1] * m2.m[1][1] + m[0][2] * m2.m[2][1] + m[0][3] * m2.m[3][1];
-    r.m[0][2] = m[0][0] * m2.m[0][2] + m[0][1] * m2.m[1][2] + m[0][2] * m2.m[2][2] + m[0][3] * m2.m[3][2];
-    r.m[0][3] = m[0][0] * m2.m[0][3] + m[0][1] * m2.m[1][3] + m[0][2] * m2.m[2][3] + m[0][3] * m2.m[3][3];
+    r.m[1][0] = a.m[1][0] * b.m[0][0] + a.m[1][1] * b.m[1][0] + a.m[1][2] * b.m[2][0] + a.m[1][3] * b.m[3][0];
+    r.m[1][1] = a.m[1][0] * b.m[0][1] + a.m[1][1] * b.m[1][1] + a.m[1][2] * b.m[2][1] + a.m[1][3] * b.m[3][1];
+    r.m[1][2] = a.m[1][0] * b.m[0][2] + a.m[1][1] * b.m[1][2] + a.m[1][2] * b.m[2][2] + a.m[1][3] * b.m[3][2];
+    r.m[1][3] = a.m[1][0] * b.m[0][3] + a.m[1][1] * b.m[1][3] + a.m[1][2] * b.m[2][3] + a.m[1][3] * b.m[3][3];
     
-    r.m[1][0] = m[1][0] * m2.m[0][0] + m[1][1] * m2.m[1][0] + m[1][2] * m2.m[2][0] + m[1][3] * m2.m[3][0];
-    r.m[1][1] = m[1][0] * m2.m[0][1] + m[1][1] * m2.m[1][1] + m[1][2] * m2.m[2][1] + m[1][3] * m2.m[3][1];
-    r.m[1][2] = m[1][0] * m2.m[0][2] + m[1][1] * m2.m[1][2] + m[1][2] * m2.m[2][2] + m[1][3] * m2.m[3][2];
-    r.m[1][3] = m[1][0] * m2.m[0][3] + m[1][1] * m2.m[1][3] + m[1][2] * m2.m[2][3] + m[1][3] * m2.m[3][3];
+    r.m[2][0] = a.m[2][0] * b.m[0][0] + a.m[2][1] * b.m[1][0] + a.m[2][2] * b.m[2][0] + a.m[2][3] * b.m[3][0];
+    r.m[2][1] = a.m[2][0] * b.m[0][1] + a.m[2][1] * b.m[1][1] + a.m[2][2] * b.m[2][1] + a.m[2][3] * b.m[3][1];
+    r.m[2][2] = a.m[2][0] * b.m[0][2] + a.m[2][1] * b.m[1][2] + a.m[2][2] * b.m[2][2] + a.m[2][3] * b.m[3][2];
+    r.m[2][3] = a.m[2][0] * b.m[0][3] + a.m[2][1] * b.m[1][3] + a.m[2][2] * b.m[2][3] + a.m[2][3] * b.m[3][3];
     
-    r.m[2][0] = m[2][0] * m2.m[0][0] + m[2][1] * m2.m[1][0] + m[2][2] * m2.m[2][0] + m[2][3] * m2.m[3][0];
-    r.m[2][1] = m[2][0] * m2.m[0][1] + m[2][1] * m2.m[1][1] + m[2][2] * m2.m[2][1] + m[2][3] * m2.m[3][1];
-    r.m[2][2] = m[2][0] * m2.m[0][2] + m[2][1] * m2.m[1][2] + m[2][2] * m2.m[2][2] + m[2][3] * m2.m[3][2];
-    r.m[2][3] = m[2][0] * m2.m[0][3] + m[2][1] * m2.m[1][3] + m[2][2] * m2.m[2][3] + m[2][3] * m2.m[3][3];
+    r.m[3][0] = a.m[3][0] * b.m[0][0] + a.m[3][1] * b.m[1][0] + a.m[3][2] * b.m[2][0] + a.m[3][3] * b.m[3][0];
+    r.m[3][1] = a.m[3][0] * b.m[0][1] + a.m[3][1] * b.m[1][1] + a.m[3][2] * b.m[2][1] + a.m[3][3] * b.m[3][1];
+    r.m[3][2] = a.m[3][0] * b.m[0][2] + a.m[3][1] * b.m[1][2] + a.m[3][2] * b.m[2][2] + a.m[3][3] * b.m[3][2];
+    r.m[3][3] = a.m[3][0] * b.m[0][3] + a.m[3][1] * b.m[1][3] + a.m[3][2] * b.m[2][3] + a.m[3][3] * b.m[3][3];
+}
+
+#ifdef MATRIX_X86
+
+// each row of the result is a linear combination of the rows of b
+MATRIX_TARGET_SSE void Matrix::MultiplySSE(const Matrix &a, const Matrix &b, Matrix &r) {
+    __m128 b0 = _mm_loadu_ps(b.m[0]);
+    __m128 b1 = _mm_loadu_ps(b.m[1]);
+    __m128 b2 = _mm_loadu_ps(b.m[2]);
+    __m128 b3 = _mm_loadu_ps(b.m[3]);
     
-    r.m[3][0] = m[3][0] * m2.m[0][0] + m[3][1] * m2.m[1][0] + m[3][2] * m2.m[2][0] + m[3][3] * m2.m[3][0];
-    r.m[3][1] = m[3][0] * m2.m[0][1] + m[3][1] * m2.m[1][1] + m[3][2] * m2.m[2][1] + m[3][3] * m2.m[3][1];
-    r.m[3][2] = m[3][0] * m2.m[0][2] + m[3][1] * m2.m[1][2] + m[3][2] * m2.m[2][2] + m[3][3] * m2.m[3][2];
-    r.m[3][3] = m[3][0] * m2.m[0][3] + m[3][1] * m2.m[1][3] + m[3][2] * m2.m[2][3] + m[3][3] * m2.m[3][3];
+    for(int i = 0; i < 4; i++) {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][2]), b2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][3]), b3));
+        _mm_storeu_ps(r.m[i], row);
+    }
+}
+
+// same as the SSE kernel but two rows of the result at a time
+MATRIX_TARGET_AVX void Matrix::MultiplyAVX(const Matrix &a, const Matrix &b, Matrix &r) {
+    __m256 b0 = _mm256_broadcast_ps((const __m128 *)b.m[0]);
+    __m256 b1 = _mm256_broadcast_ps((const __m128 *)b.m[1]);
+    __m256 b2 = _mm256_broadcast_ps((const __m128 *)b.m[2]);
+    __m256 b3 = _mm256_broadcast_ps((const __m128 *)b.m[3]);
     
-    return r;
+    for(int i = 0; i < 4; i += 2) {
+        __m256 rows = _mm256_loadu_ps(a.m[i]);
+        __m256 result = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x00), b0);
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x55), b1));
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xAA), b2));
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xFF), b3));
+        _mm256_storeu_ps(r.m[i], result);
+    }
+    _mm256_zeroupper();
+}
+
+static void CPUID(int info[4], int leaf) {
+#ifdef _MSC_VER
+    __cpuid(info, leaf);
+#else
+    __cpuid_count(leaf, 0, info[0], info[1], info[2], info[3]);
+#endif
 }
 
-void Matrix::SetPosition(float x, float y, float z) {
-    m[3][0] = x;
-    m[3][1] = y;
-    m[3][2] = z;
+bool Matrix::HasSSE() {
+    int info[4];
+    CPUID(info, 1);
+    // the kernels use SSE2 integer instructions as well
+    return (info[3] & (1 << 26)) != 0;
+}
+
+bool Matrix::HasAVX() {
+    int info[4];
+    CPUID(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if(!osxsave || !avx) {
+        return false;
+    }
+    // the OS also has to save the YMM registers on a context switch
+#ifdef _MSC_VER
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    unsigned long long xcr0 = ((unsigned long long)edx << 32) | eax;
+#endif
+    return (xcr0 & 6) == 6;
+}
+
+#else
+
+bool Matrix::HasSSE() {
+    return false;
+}
+
+bool Matrix::HasAVX() {
+    return false;
+}
+
+#endif
+
+Matrix::MultiplyFunction Matrix::SelectMultiply() {
+#ifdef MATRIX_X86
+    if(HasAVX()) {
+        return MultiplyAVX;
+    }
+    if(HasSSE()) {
+        return MultiplySSE;
+    }
+#endif
+    return MultiplyScalar;
 }
 
 void Matrix::Translate(float x, float y, float z) {
@@ -145,52 +353,62 @@ void Matrix::SetRotation(float rotation) {
 }
 
 void Matrix::SetRoll(float roll) {
-    m[0][0] = cos(roll);
-    m[1][0] = -sin(roll);
-    m[0][1] = sin(roll);
-    m[1][1] = cos(roll);
+    float sine, cosine;
+    SinCos(roll, sine, cosine);
+    m[0][0] = cosine;
+    m[1][0] = -sine;
+    m[0][1] = sine;
+    m[1][1] = cosine;
 }
 
 void Matrix::Rotate(float rotation) {
     Roll(rotation);
 }
 
+// multiplying by a rotation on the left only mixes two rows, so do that in place
+// instead of building a rotation matrix and running a full multiply
+static void RotateRows(float *a, float *b, float sine, float cosine) {
+    for(int i = 0; i < 4; i++) {
+        float newA = cosine * a[i] + sine * b[i];
+        b[i] = cosine * b[i] - sine * a[i];
+        a[i] = newA;
+    }
+}
+
 void Matrix::Roll(float roll) {
-    Matrix rollMatrix;
-    rollMatrix.SetRoll(roll);
-    (*this) = rollMatrix * (*this);
+    float sine, cosine;
+    SinCos(roll, sine, cosine);
+    RotateRows(m[0], m[1], sine, cosine);
 }
 
 void Matrix::SetPitch(float pitch) {
-    m[1][1] = cos(pitch);
-    m[2][1] = -sin(pitch);
-    m[1][2] = sin(pitch);
-    m[2][2] = cos(pitch);
+    float sine, cosine;
+    SinCos(pitch, sine, cosine);
+    m[1][1] = cosine;
+    m[2][1] = -sine;
+    m[1][2] = sine;
+    m[2][2] = cosine;
 }
 
 void Matrix::SetYaw(float yaw) {
-    m[0][0] = cos(yaw);
-    m[2][0] = sin(yaw);
-    m[0][2] = -sin(yaw);
-    m[2][2] = cos(yaw);
+    float sine, cosine;
+    SinCos(yaw, sine, cosine);
+    m[0][0] = cosine;
+    m[2][0] = sine;
+    m[0][2] = -sine;
+    m[2][2] = cosine;
 }
 
 void Matrix::Pitch(float pitch) {
-    Matrix pitchMatrix;
-    pitchMatrix.SetPitch(pitch);
-    (*this) = pitchMatrix * (*this);
+    float sine, cosine;
+    SinCos(pitch, sine, cosine);
+    RotateRows(m[1], m[2], sine, cosine);
 }
 
 void Matrix::Yaw(float yaw) {
-    Matrix yawMatrix;
-    yawMatrix.SetYaw(yaw);
-    (*this) = yawMatrix * (*this);
-}
-
-void Matrix::SetScale(float x, float y, float z) {
-    m[0][0] = x;
-    m[1][1] = y;
-    m[2][2] = z;
+    float sine, cosine;
+    SinCos(yaw, sine, cosine);
+    RotateRows(m[2], m[0], sine, cosine);
 }
 
 void Matrix::Scale(float x, float y, float z) {
@@ -199,21 +417,186 @@ void Matrix::Scale(float x, float y, float z) {
     (*this) = scaleMatrix * (*this);
 }
 
-void Matrix::SetOrthoProjection(float left, float right, float bottom, float top, float zNear, float zFar) {
-    m[0][0] = 2.0f/(right-left);
-    m[1][1] = 2.0f/(top-bottom);
-    m[2][2] = -2.0f/(zFar-zNear);
+#ifdef MATRIX_X86
+
+// two interleaved points per register: [x0 y0 x1 y1]
+MATRIX_TARGET_SSE static int TransformPointsSSE(const Matrix &matrix, const float *src, float *dst, int count) {
+    __m128 col0 = _mm_setr_ps(matrix.m[0][0], matrix.m[0][1], matrix.m[0][0], matrix.m[0][1]);
+    __m128 col1 = _mm_setr_ps(matrix.m[1][0], matrix.m[1][1], matrix.m[1][0], matrix.m[1][1]);
+    __m128 col3 = _mm_setr_ps(matrix.m[3][0], matrix.m[3][1], matrix.m[3][0], matrix.m[3][1]);
+    
+    int i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128 points = _mm_loadu_ps(src + i * 2);
+        __m128 xs = _mm_shuffle_ps(points, points, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 ys = _mm_shuffle_ps(points, points, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, col0), _mm_mul_ps(ys, col1)), col3);
+        _mm_storeu_ps(dst + i * 2, result);
+    }
+    return i;
+}
+
+// four points per register, one register for x and one for y
+MATRIX_TARGET_SSE static int TransformPointsSSE(const Matrix &matrix, const float *srcX, const float *srcY, float *dstX, float *dstY, int count) {
+    __m128 m00 = _mm_set1_ps(matrix.m[0][0]);
+    __m128 m01 = _mm_set1_ps(matrix.m[0][1]);
+    __m128 m10 = _mm_set1_ps(matrix.m[1][0]);
+    __m128 m11 = _mm_set1_ps(matrix.m[1][1]);
+    __m128 m30 = _mm_set1_ps(matrix.m[3][0]);
+    __m128 m31 = _mm_set1_ps(matrix.m[3][1]);
+    
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(srcX + i);
+        __m128 y = _mm_loadu_ps(srcY + i);
+        __m128 newX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), m30);
+        __m128 newY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), m31);
+        _mm_storeu_ps(dstX + i, newX);
+        _mm_storeu_ps(dstY + i, newY);
+    }
+    return i;
+}
+
+#endif
+
+void Matrix::TransformPoints(const float *src, float *dst, int count) const {
+    int i = 0;
+#ifdef MATRIX_X86
+    static bool sse = HasSSE();
+    if(sse) {
+        i = TransformPointsSSE(*this, src, dst, count);
+    }
+#endif
+    for(; i < count; i++) {
+        float x = src[i * 2];
+        float y = src[i * 2 + 1];
+        dst[i * 2] = m[0][0] * x + m[1][0] * y + m[3][0];
+        dst[i * 2 + 1] = m[0][1] * x + m[1][1] * y + m[3][1];
+    }
+}
+
+void Matrix::TransformPoints(const float *srcX, const float *srcY, float *dstX, float *dstY, int count) const {
+    int i = 0;
+#ifdef MATRIX_X86
+    static bool sse = HasSSE();
+    if(sse) {
+        i = TransformPointsSSE(*this, srcX, srcY, dstX, dstY, count);
+    }
+#endif
+    for(; i < count; i++) {
+        float x = srcX[i];
+        float y = srcY[i];
+        dstX[i] = m[0][0] * x + m[1][0] * y + m[3][0];
+        dstY[i] = m[0][1] * x + m[1][1] * y + m[3][1];
+    }
+}
+
+bool Matrix::fastTrig = false;
+
+// pi/2 split in three so the range reduction stays exact for large angles
+#define PI_OVER_2_A 1.5703125f
+#define PI_OVER_2_B 4.837512969970703125e-4f
+#define PI_OVER_2_C 7.549789948768648e-8f
+#define TWO_OVER_PI 0.636619772367581343f
+
+void Matrix::SinCos(float angle, float &sine, float &cosine) {
+    if(fastTrig) {
+        SinCosFast(angle, sine, cosine);
+    } else {
+        sine = sinf(angle);
+        cosine = cosf(angle);
+    }
+}
+
+// reduces to [-pi/4, pi/4] around the nearest multiple of pi/2, then one taylor
+// polynomial each for sin and cos, swapped and negated by quadrant
+void Matrix::SinCosFast(float angle, float &sine, float &cosine) {
+    float q = floorf(angle * TWO_OVER_PI + 0.5f);
+    int quadrant = (int)q;
+    float r = ((angle - q * PI_OVER_2_A) - q * PI_OVER_2_B) - q * PI_OVER_2_C;
+    float r2 = r * r;
+    
+    float s = r + r * r2 * (-1.6666667e-1f + r2 * (8.3333333e-3f + r2 * -1.9841270e-4f));
+    float c = 1.0f + r2 * (-0.5f + r2 * (4.1666667e-2f + r2 * (-1.3888889e-3f + r2 * 2.4801587e-5f)));
+    
+    if(quadrant & 1) {
+        float temp = s;
+        s = c;
+        c = temp;
+    }
+    sine = (quadrant & 2) ? -s : s;
+    cosine = ((quadrant + 1) & 2) ? -c : c;
+}
+
+#ifdef MATRIX_X86
+
+// same polynomial as SinCosFast, four angles at a time
+MATRIX_TARGET_SSE static int SinCosFastSSE(const float *angles, float *sines, float *cosines, int count) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i oneInt = _mm_set1_epi32(1);
+    const __m128i twoInt = _mm_set1_epi32(2);
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 angle = _mm_loadu_ps(angles + i);
+        __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(TWO_OVER_PI)));
+        __m128 q = _mm_cvtepi32_ps(quadrant);
+        __m128 r = _mm_sub_ps(angle, _mm_mul_ps(q, _mm_set1_ps(PI_OVER_2_A)));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PI_OVER_2_B)));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PI_OVER_2_C)));
+        __m128 r2 = _mm_mul_ps(r, r);
+        
+        __m128 s = _mm_add_ps(_mm_set1_ps(8.3333333e-3f), _mm_mul_ps(r2, _mm_set1_ps(-1.9841270e-4f)));
+        s = _mm_add_ps(_mm_set1_ps(-1.6666667e-1f), _mm_mul_ps(r2, s));
+        s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), s));
+        
+        __m128 c = _mm_add_ps(_mm_set1_ps(-1.3888889e-3f), _mm_mul_ps(r2, _mm_set1_ps(2.4801587e-5f)));
+        c = _mm_add_ps(_mm_set1_ps(4.1666667e-2f), _mm_mul_ps(r2, c));
+        c = _mm_add_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(r2, c));
+        c = _mm_add_ps(one, _mm_mul_ps(r2, c));
+        
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, oneInt), oneInt));
+        __m128 newS = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+        __m128 newC = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+        
+        __m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, twoInt), 30));
+        __m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, oneInt), twoInt), 30));
+        _mm_storeu_ps(sines + i, _mm_xor_ps(newS, _mm_and_ps(sineSign, signMask)));
+        _mm_storeu_ps(cosines + i, _mm_xor_ps(newC, _mm_and_ps(cosineSign, signMask)));
+    }
+    return i;
+}
+
+#endif
 
-    m[3][0] = -((right+left)/(right-left));
-    m[3][1] = -((top+bottom)/(top-bottom));
-    m[3][2] = -((zFar+zNear)/(zFar-zNear));
+void Matrix::SinCos(const float *angles, float *sines, float *cosines, int count) {
+    int i = 0;
+#ifdef MATRIX_X86
+    static bool sse = HasSSE();
+    if(fastTrig && sse) {
+        i = SinCosFastSSE(angles, sines, cosines, count);
+    }
+#endif
+    for(; i < count; i++) {
+        SinCos(angles[i], sines[i], cosines[i]);
+    }
 }
 
-void Matrix::SetPerspectiveProjection(float fov, float aspect, float zNear, float zFar) {    
-    m[0][0] = 1.0f/tanf(fov/2.0)/aspect;
-    m[1][1] = 1.0f/tanf(fov/2.0);
-    m[2][2] = (zFar+zNear)/(zNear-zFar);
-    m[3][2] = (2.0f*zFar*zNear)/(zNear-zFar);
-    m[2][3] = -1.0f;
-    m[3][3] = 0.0f;
+void Matrix::SetRoll(Matrix *matrices, const float *rolls, int count) {
+    // sin and cos for the whole batch first so the SSE path can run
+    const int batchSize = 64;
+    float sines[batchSize];
+    float cosines[batchSize];
+    for(int start = 0; start < count; start += batchSize) {
+        int batch = count - start < batchSize ? count - start : batchSize;
+        SinCos(rolls + start, sines, cosines, batch);
+        for(int i = 0; i < batch; i++) {
+            Matrix &matrix = matrices[start + i];
+            matrix.m[0][0] = cosines[i];
+            matrix.m[1][0] = -sines[i];
+            matrix.m[0][1] = sines[i];
+            matrix.m[1][1] = cosines[i];
+        }
+    }
 }
@@ -0,0 +1,50 @@
+#include "QuadIndexBuffer.h"
+
+QuadIndexBuffer::QuadIndexBuffer(int maxQuads) : buffer(0), maxQuads(maxQuads), frameBytesSaved(0), lastFrameBytesSaved(0) {
+    indices.reserve(maxQuads * 6);
+    for(int i = 0; i < maxQuads; i++) {
+        unsigned short first = (unsigned short)(i * 4);
+        indices.insert(indices.end(), {
+            first, (unsigned short)(first + 1), (unsigned short)(first + 2),
+            (unsigned short)(first + 1), first, (unsigned short)(first + 3)
+        });
+    }
+}
+
+QuadIndexBuffer &QuadIndexBuffer::Shared() {
+    static QuadIndexBuffer shared;
+    return shared;
+}
+
+void QuadIndexBuffer::Draw(int quadCount, int vertexBytes) {
+    if(quadCount > maxQuads) {
+        quadCount = maxQuads;
+    }
+#ifdef _WINDOWS
+    if(buffer == 0) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+    }
+    // left bound afterwards, nothing draws from client index arrays
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    glDrawElements(GL_TRIANGLES, quadCount * 6, GL_UNSIGNED_SHORT, (const void *)0);
+#else
+    glDrawElements(GL_TRIANGLES, quadCount * 6, GL_UNSIGNED_SHORT, indices.data());
+#endif
+    frameBytesSaved += (unsigned long long)quadCount * 2 * vertexBytes;
+}
+
+void QuadIndexBuffer::EndFrame() {
+    lastFrameBytesSaved = frameBytesSaved;
+    frameBytesSaved = 0;
+}
+
+void QuadIndexBuffer::Cleanup() {
+#ifdef _WINDOWS
+    if(buffer != 0) {
+        glDeleteBuffers(1, &buffer);
+    }
+#endif
+    buffer = 0;
+}
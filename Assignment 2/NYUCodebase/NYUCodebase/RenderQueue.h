@@ -0,0 +1,64 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <vector>
+#include "ShaderProgram.h"
+#include "SpriteBatch.h"
+#include "Transform2D.h"
+
+enum RenderBlend { RENDER_BLEND_NONE, RENDER_BLEND_ALPHA, RENDER_BLEND_ADDITIVE };
+
+// one sprite quad waiting in the queue, the same arguments SpriteBatch::Draw takes plus the state it needs
+struct RenderCommand {
+    ShaderProgram *program;
+    GLuint texture;
+    RenderBlend blend;
+    Transform2D transform;
+    float left, bottom, right, top;
+    float u0, v0, u1, v1;
+};
+
+// collects a frame of sprite draws and sends them in state order instead of the order they were
+// added. Every command gets a 64 bit key, most significant first:
+//
+//  | layer 8 | program 8 | texture 16 | blend 4 | depth 28 |
+//
+// Submit radix sorts the keys and walks them through the batch, so all sprites of a texture go out
+// in one draw and the program and blend state only change between runs. Layers always draw in
+// order, lower first. The sort is stable, commands with the same key keep the order they were added
+class RenderQueue {
+    public:
+
+        RenderQueue();
+
+        void Add(const RenderCommand &command, int layer, unsigned int depth = 0);
+        // sorts, draws and empties the queue, once a frame
+        void Submit();
+
+        static unsigned long long Key(int layer, const ShaderProgram *program, GLuint texture, RenderBlend blend, unsigned int depth);
+
+        struct SortEntry {
+            unsigned long long key;
+            unsigned int command;
+        };
+
+        std::vector<RenderCommand> commands;
+        std::vector<SortEntry> entries;
+        // the radix sort ping pongs between entries and this
+        std::vector<SortEntry> scratch;
+        // does the drawing, set batch.ring to stream through a ring
+        SpriteBatch batch;
+
+        // from the last Submit
+        int submitted;
+        int drawCalls;
+        int programChanges;
+        int blendChanges;
+
+    private:
+        void Sort();
+        static void ApplyBlend(RenderBlend blend);
+};
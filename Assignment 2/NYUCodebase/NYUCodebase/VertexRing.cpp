@@ -0,0 +1,181 @@
+#include "VertexRing.h"
+#include <string.h>
+
+// attribute pointers into the ring stay aligned for any vertex format
+#define VERTEX_RING_ALIGNMENT 16
+
+VertexRing::VertexRing(size_t regionBytes) : buffer(0), persistent(false), mapped(NULL), regionBytes(regionBytes), region(0), head(0),
+    bytesStreamed(0), fenceWaits(0), orphans(0) {
+#ifdef _WINDOWS
+    for(int i = 0; i < VERTEX_RING_REGIONS; i++) {
+        fences[i] = 0;
+    }
+#endif
+}
+
+void VertexRing::Create() {
+#ifdef _WINDOWS
+    size_t size = regionBytes * VERTEX_RING_REGIONS;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    persistent = PersistentSupported();
+    if(persistent) {
+        // coherent, so writes are visible to the GPU without flushing ranges
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        mapped = (unsigned char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if(mapped == NULL) {
+            // storage is immutable, start again with a plain buffer
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            persistent = false;
+        }
+    }
+    if(!persistent) {
+        // the driver does the buffering behind an orphaned buffer, one frame's worth is enough
+        glBufferData(GL_ARRAY_BUFFER, regionBytes, NULL, GL_STREAM_DRAW);
+    }
+    region = 0;
+    head = 0;
+#endif
+}
+
+bool VertexRing::Reserve(size_t bytes, int streams) {
+#ifdef _WINDOWS
+    if(Supported()) {
+        if(buffer == 0) {
+            Create();
+        }
+        size_t aligned = bytes + streams * (VERTEX_RING_ALIGNMENT - 1);
+        if(persistent && aligned <= regionBytes) {
+            if(head + aligned > regionBytes) {
+                // nothing of this draw is in the region yet, so its fence covers every draw reading it
+                NextRegion();
+            }
+            return true;
+        }
+        return !persistent && head + aligned <= regionBytes;
+    }
+    return false;
+#else
+    (void)bytes;
+    (void)streams;
+    return false;
+#endif
+}
+
+const void *VertexRing::Stream(const void *data, size_t bytes) {
+#ifdef _WINDOWS
+    if(Supported()) {
+        if(buffer == 0) {
+            Create();
+        }
+        size_t aligned = (bytes + VERTEX_RING_ALIGNMENT - 1) & ~(size_t)(VERTEX_RING_ALIGNMENT - 1);
+        // no moving on to the next region here, an earlier Stream of the same draw may be in this
+        // one and its fence would go in before that draw. Reserve moves on between draws.
+        // orphaning here could likewise pull the storage out from under an attribute already
+        // pointed into the ring, so a frame that overflows uses client arrays for the rest
+        if(head + aligned <= regionBytes) {
+            size_t offset = head;
+            if(persistent) {
+                offset += region * regionBytes;
+                memcpy(mapped + offset, data, bytes);
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            } else {
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+                // only ever written past what earlier draws read, so nothing has to wait
+                glBufferSubData(GL_ARRAY_BUFFER, head, bytes, data);
+            }
+            head += aligned;
+            bytesStreamed += bytes;
+            return (const void *)offset;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+#else
+    (void)bytes;
+#endif
+    return data;
+}
+
+void VertexRing::Unbind() {
+#ifdef _WINDOWS
+    if(buffer != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+#endif
+}
+
+void VertexRing::NextRegion() {
+#ifdef _WINDOWS
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % VERTEX_RING_REGIONS;
+    head = 0;
+    if(fences[region] != 0) {
+        // normally signalled long ago, two frames have been queued since
+        if(glClientWaitSync(fences[region], 0, 0) == GL_TIMEOUT_EXPIRED) {
+            fenceWaits++;
+            while(glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+            }
+        }
+        glDeleteSync(fences[region]);
+        fences[region] = 0;
+    }
+#endif
+}
+
+void VertexRing::EndFrame() {
+    if(persistent && head > 0) {
+        NextRegion();
+    }
+#ifdef _WINDOWS
+    if(!persistent && head > 0) {
+        // the driver hands us fresh storage and frees the old one once the GPU is done with it
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, regionBytes, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        head = 0;
+        orphans++;
+    }
+#endif
+}
+
+void VertexRing::Cleanup() {
+#ifdef _WINDOWS
+    for(int i = 0; i < VERTEX_RING_REGIONS; i++) {
+        if(fences[i] != 0) {
+            glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+    }
+    if(buffer != 0) {
+        if(persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+    }
+#endif
+    buffer = 0;
+    mapped = NULL;
+    persistent = false;
+}
+
+bool VertexRing::Supported() {
+#ifdef _WINDOWS
+    // vertex buffers are core since 1.5, every context GLEW gives us has them
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool VertexRing::PersistentSupported() {
+#ifdef _WINDOWS
+    return GLEW_ARB_buffer_storage && GLEW_ARB_sync && GLEW_ARB_map_buffer_range;
+#else
+    return false;
+#endif
+}
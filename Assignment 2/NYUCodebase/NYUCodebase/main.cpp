@@ -7,6 +7,7 @@
 #include <SDL_image.h>
 #include "ShaderProgram.h"
 #include "Matrix.h"
+#include "VertexRing.h"
 #include "stb_image.h"
 
 
@@ -19,6 +20,9 @@
 
 SDL_Window* displayWindow;
 
+//Every frame's vertices are streamed through this instead of being copied out of client arrays by the driver
+VertexRing vertexRing;
+
 GLuint LoadTexture(const char *filePath) {
 	int w, h, comp;
 	unsigned char* image = stbi_load(filePath, &w, &h, &comp, STBI_rgb_alpha);
@@ -53,7 +57,8 @@ int main(int argc, char *argv[])
 
 	//Load the shader program
 	ShaderProgram program;
-	program.Load(RESOURCE_FOLDER"vertex.glsl", RESOURCE_FOLDER"fragment.glsl");
+	program.Submit(RESOURCE_FOLDER"vertex.glsl", RESOURCE_FOLDER"fragment.glsl");
+	//Compiles in the background, it gets finished the first time the program is used
 
 	//Load the matrices
 	Matrix projectionMatrix;
@@ -118,7 +123,7 @@ int main(int argc, char *argv[])
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		//Use the specified program ID
-		glUseProgram(program.programID);
+		program.Use();
 
 
 		//Keeping time
@@ -141,10 +146,11 @@ int main(int argc, char *argv[])
 			4.75, 2.75, //bottom right
 			-4.75, 2.75 //bottom keft
 		};
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, topBarVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
+		program.layout.Bind(!vertexRing.Reserve(sizeof(topBarVertices)));
+		program.layout.Pointer(0, vertexRing.Stream(topBarVertices, sizeof(topBarVertices)));
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program.positionAttribute);
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
 		float bottomBarVertices[] = {
 			-4.75, -2.75, //bottom left
@@ -155,10 +161,11 @@ int main(int argc, char *argv[])
 			-4.75, -2.75 //bottom keft
 		};
 
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, bottomBarVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
+		program.layout.Bind(!vertexRing.Reserve(sizeof(bottomBarVertices)));
+		program.layout.Pointer(0, vertexRing.Stream(bottomBarVertices, sizeof(bottomBarVertices)));
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program.positionAttribute);
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
 		program.SetColor(1.0f, 1.0f, 1.0f, 1.0f);
 		if (winner == 0) {
@@ -191,10 +198,11 @@ int main(int argc, char *argv[])
 		
 		program.SetModelMatrix(leftPadMatrix);
 
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, leftPadVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
+		program.layout.Bind(!vertexRing.Reserve(sizeof(leftPadVertices)));
+		program.layout.Pointer(0, vertexRing.Stream(leftPadVertices, sizeof(leftPadVertices)));
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program.positionAttribute);
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
 		//Move the CPU paddle on the right
 		rightPadMatrix.Translate(0.0, (sin(angle) * 0.0009) * ydirection, 0.0);
@@ -218,10 +226,11 @@ int main(int argc, char *argv[])
 			 5.00, -1.0  //bottom left
 		};
 
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, rightPadVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
+		program.layout.Bind(!vertexRing.Reserve(sizeof(rightPadVertices)));
+		program.layout.Pointer(0, vertexRing.Stream(rightPadVertices, sizeof(rightPadVertices)));
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program.positionAttribute);
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
 		//Move the ball based on angle
 		ballMatrix.Translate((cos(angle) * 0.001) * xdirection, (sin(angle) * 0.001) * ydirection, 0.0);
@@ -318,14 +327,18 @@ int main(int argc, char *argv[])
 			-0.25, 0.25
 		};
 
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, ballVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
+		program.layout.Bind(!vertexRing.Reserve(sizeof(ballVertices)));
+		program.layout.Pointer(0, vertexRing.Stream(ballVertices, sizeof(ballVertices)));
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program.positionAttribute);
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
 		SDL_GL_SwapWindow(displayWindow);
+		//Next frame writes to the next region of the ring
+		vertexRing.EndFrame();
 	}
 
+	vertexRing.Cleanup();
 	SDL_Quit();
 	return 0;
 }
@@ -0,0 +1,44 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <string>
+
+#define COOKED_TEXTURE_MAGIC 0x58455443
+#define COOKED_TEXTURE_VERSION 1
+#define COOKED_TEXTURE_MAX_LEVELS 16
+#define COOKED_TEXTURE_RGBA8 0
+
+// .ctex layout, all little endian: the header, one CookedTextureLevel per mip level, then the raw
+// RGBA pixels of each level at its offset. Nothing to inflate, the loader maps the file and hands
+// the levels straight to glTexImage2D
+struct CookedTextureHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int width;
+    unsigned int height;
+    unsigned int levels;
+    unsigned int format;
+};
+
+struct CookedTextureLevel {
+    unsigned int width;
+    unsigned int height;
+    unsigned int offset;
+    unsigned int size;
+};
+
+class CookedTexture {
+    public:
+
+        // decodes the image and writes it with a full mip chain down to 1x1
+        static bool Cook(const std::string &imageFile, const std::string &cookedFile);
+        // uploads every level and turns on trilinear filtering, 0 if the file is missing or bad.
+        // bytes gets the GPU size of the whole chain
+        static GLuint Load(const std::string &cookedFile, int *width = NULL, int *height = NULL, size_t *bytes = NULL);
+        // sheet.png -> sheet.ctex
+        static std::string CookedPath(const std::string &imageFile);
+        static bool Exists(const std::string &cookedFile);
+};
@@ -0,0 +1,32 @@
+#include "PackedVertex.h"
+#include <math.h>
+
+short PackPosition(float position, float scale) {
+    float step = floorf(position * scale + 0.5f);
+    if(step < -32768.0f) {
+        return -32768;
+    }
+    if(step > 32767.0f) {
+        return 32767;
+    }
+    return (short)step;
+}
+
+unsigned short PackTexCoord(float texCoord) {
+    if(texCoord <= 0.0f) {
+        return 0;
+    }
+    if(texCoord >= 1.0f) {
+        return 65535;
+    }
+    return (unsigned short)(texCoord * 65535.0f + 0.5f);
+}
+
+void PackVertices(const float *positions, const float *texCoords, size_t count, float positionScale, PackedVertex *packed) {
+    for(size_t i = 0; i < count; i++) {
+        packed[i].x = PackPosition(positions[i * 2], positionScale);
+        packed[i].y = PackPosition(positions[i * 2 + 1], positionScale);
+        packed[i].u = PackTexCoord(texCoords[i * 2]);
+        packed[i].v = PackTexCoord(texCoords[i * 2 + 1]);
+    }
+}
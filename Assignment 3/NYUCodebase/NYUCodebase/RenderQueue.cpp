@@ -0,0 +1,102 @@
+#include "RenderQueue.h"
+
+RenderQueue::RenderQueue() : submitted(0), drawCalls(0), programChanges(0), blendChanges(0) {}
+
+unsigned long long RenderQueue::Key(int layer, const ShaderProgram *program, GLuint texture, RenderBlend blend, unsigned int depth) {
+    // GL hands out small names, the low bits are enough to tell the few programs and textures apart
+    return ((unsigned long long)(layer & 0xFF) << 56) |
+        ((unsigned long long)(program->programID & 0xFF) << 48) |
+        ((unsigned long long)(texture & 0xFFFF) << 32) |
+        ((unsigned long long)(blend & 0xF) << 28) |
+        (unsigned long long)(depth & 0x0FFFFFFF);
+}
+
+void RenderQueue::Add(const RenderCommand &command, int layer, unsigned int depth) {
+    SortEntry entry;
+    entry.key = Key(layer, command.program, command.texture, command.blend, depth);
+    entry.command = (unsigned int)commands.size();
+    entries.push_back(entry);
+    commands.push_back(command);
+}
+
+void RenderQueue::Sort() {
+    // least significant byte first, each pass a stable counting sort on one byte
+    size_t count = entries.size();
+    scratch.resize(count);
+    for(int shift = 0; shift < 64; shift += 8) {
+        size_t offsets[256] = {};
+        for(size_t i = 0; i < count; i++) {
+            offsets[(entries[i].key >> shift) & 0xFF]++;
+        }
+        if(offsets[(entries[0].key >> shift) & 0xFF] == count) {
+            // every key has the same byte here, most of them do in a frame
+            continue;
+        }
+        size_t total = 0;
+        for(int i = 0; i < 256; i++) {
+            size_t bucket = offsets[i];
+            offsets[i] = total;
+            total += bucket;
+        }
+        for(size_t i = 0; i < count; i++) {
+            scratch[offsets[(entries[i].key >> shift) & 0xFF]++] = entries[i];
+        }
+        entries.swap(scratch);
+    }
+}
+
+void RenderQueue::ApplyBlend(RenderBlend blend) {
+    switch(blend) {
+    case RENDER_BLEND_NONE:
+        glDisable(GL_BLEND);
+        break;
+    case RENDER_BLEND_ALPHA:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    case RENDER_BLEND_ADDITIVE:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        break;
+    }
+}
+
+void RenderQueue::Submit() {
+    submitted = (int)entries.size();
+    drawCalls = 0;
+    programChanges = 0;
+    blendChanges = 0;
+    if(entries.empty()) {
+        return;
+    }
+    Sort();
+
+    ShaderProgram *program = NULL;
+    int blend = -1;
+    for(size_t i = 0; i < entries.size(); i++) {
+        const RenderCommand &command = commands[entries[i].command];
+        if(command.program != program) {
+            if(program != NULL) {
+                batch.End();
+                drawCalls += batch.drawCalls;
+            }
+            program = command.program;
+            batch.Begin(program);
+            programChanges++;
+        }
+        if(command.blend != blend) {
+            // what's collected so far was added under the old state
+            batch.Flush();
+            ApplyBlend(command.blend);
+            blend = command.blend;
+            blendChanges++;
+        }
+        batch.Draw(command.texture, command.transform, command.left, command.bottom, command.right, command.top,
+            command.u0, command.v0, command.u1, command.v1);
+    }
+    batch.End();
+    drawCalls += batch.drawCalls;
+
+    commands.clear();
+    entries.clear();
+}
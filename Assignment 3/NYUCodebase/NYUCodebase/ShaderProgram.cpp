@@ -1,22 +1,110 @@
 
 #include "ShaderProgram.h"
+#include "PackedVertex.h"
+#include <string.h>
+#include <stdio.h>
+#include <chrono>
 
-void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShaderFile) {
+GLuint ShaderProgram::boundProgram = 0;
+unsigned long long ShaderProgram::skippedCalls = 0;
+GLuint ShaderProgram::cameraBuffer = 0;
+Matrix ShaderProgram::cameraViewMatrix;
+Matrix ShaderProgram::cameraProjectionMatrix;
+bool ShaderProgram::cameraViewMatrixSet = false;
+bool ShaderProgram::cameraProjectionMatrixSet = false;
+std::vector<ShaderProgram *> ShaderProgram::programs;
+
+// binding point and std140 layout of the Camera block in the vertex shaders
+#define CAMERA_BLOCK_BINDING 0
+#define CAMERA_VIEW_OFFSET 0
+#define CAMERA_PROJECTION_OFFSET 64
+#define CAMERA_BLOCK_SIZE 128
+
+// prepended to the shader sources when the Camera block is used, the shaders have no #version line
+static const char *cameraBlockPreamble = "#extension GL_ARB_uniform_buffer_object : require\n#define CAMERA_BLOCK\n";
+
+void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShaderFile, const std::string &defines) {
+    Submit(vertexShaderFile, fragmentShaderFile, defines);
+    Finish();
+}
+
+void ShaderProgram::Submit(const char *vertexShaderFile, const char *fragmentShaderFile, const std::string &defines) {
     
-    // create the vertex shader
-    vertexShader = LoadShaderFromFile(vertexShaderFile, GL_VERTEX_SHADER);
-    // create the fragment shader
-    fragmentShader = LoadShaderFromFile(fragmentShaderFile, GL_FRAGMENT_SHADER);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    submitTime = start;
+    EnableParallelCompile();
     
-    // Create the final shader program from our vertex and fragment shaders
-    programID = glCreateProgram();
-    glAttachShader(programID, vertexShader);
-    glAttachShader(programID, fragmentShader);
-    glLinkProgram(programID);
+    this->vertexShaderFile = vertexShaderFile;
+    this->fragmentShaderFile = fragmentShaderFile;
+    vertexSource = ReadShaderFile(vertexShaderFile);
+    fragmentSource = ReadShaderFile(fragmentShaderFile);
+    this->defines = defines;
+    
+    usesCameraBlock = CameraBlockSupported();
+    vertexShader = 0;
+    fragmentShader = 0;
+    // nothing here asks the driver for a result, so the compile and link can run in the background
+    loadedFromCache = LoadCachedBinary(vertexShaderFile, fragmentShaderFile, vertexSource, fragmentSource);
+    if(!loadedFromCache) {
+        Link(vertexSource, fragmentSource);
+    }
+    pending = true;
+    
+    modelMatrixSet = false;
+    modelNode = nullptr;
+    viewMatrixSet = false;
+    projectionMatrixSet = false;
+    colorSet = false;
+    
+    programs.push_back(this);
+    
+    loadMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ShaderProgram::IsReady() {
+    if(!pending) {
+        return true;
+    }
+#ifdef _WINDOWS
+    if(ParallelCompileSupported()) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(programID, GL_COMPLETION_STATUS_ARB, &completed);
+        return completed == GL_TRUE;
+    }
+#endif
+    // without the extension there is no way to ask, Finish just blocks
+    return true;
+}
+
+void ShaderProgram::Finish() {
+    if(!pending) {
+        return;
+    }
+    pending = false;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     
     GLint linkSuccess;
     glGetProgramiv(programID, GL_LINK_STATUS, &linkSuccess);
+    if(loadedFromCache && linkSuccess == GL_FALSE) {
+        // driver update or a binary it no longer likes, compile from source instead
+        glDeleteProgram(programID);
+        loadedFromCache = false;
+        Link(vertexSource, fragmentSource);
+        glGetProgramiv(programID, GL_LINK_STATUS, &linkSuccess);
+    }
+    if(linkSuccess == GL_FALSE && usesCameraBlock) {
+        // the driver didn't take the uniform block, fall back to plain uniforms
+        std::cout << "Camera uniform block failed to build, using per program uniforms" << std::endl;
+        glDeleteProgram(programID);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        usesCameraBlock = false;
+        Link(vertexSource, fragmentSource);
+        glGetProgramiv(programID, GL_LINK_STATUS, &linkSuccess);
+    }
     if(linkSuccess == GL_FALSE) {
+        CheckShader(vertexShader);
+        CheckShader(fragmentShader);
 	printf("Error linking shader program!\n");
     }
     
@@ -27,18 +115,97 @@ void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShade
     
     positionAttribute = glGetAttribLocation(programID, "position");
     texCoordAttribute = glGetAttribLocation(programID, "texCoord");
+    layout.Cleanup();
+    layout = VertexLayout();
+    layout.Add(positionAttribute, 2, GL_FLOAT);
+    layout.Add(texCoordAttribute, 2, GL_FLOAT);
+    packedLayout.Cleanup();
+    packedLayout = VertexLayout();
+    packedLayout.Add(positionAttribute, 2, GL_SHORT, false, sizeof(PackedVertex));
+    packedLayout.Add(texCoordAttribute, 2, GL_UNSIGNED_SHORT, true, sizeof(PackedVertex));
+    
+#ifdef _WINDOWS
+    if(usesCameraBlock) {
+        GLuint cameraBlockIndex = glGetUniformBlockIndex(programID, "Camera");
+        if(cameraBlockIndex == GL_INVALID_INDEX) {
+            // shader without the block, it still has the plain uniforms
+            usesCameraBlock = false;
+        } else {
+            glUniformBlockBinding(programID, cameraBlockIndex, CAMERA_BLOCK_BINDING);
+            if(cameraBuffer == 0) {
+                glGenBuffers(1, &cameraBuffer);
+                glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+                glBufferData(GL_UNIFORM_BUFFER, CAMERA_BLOCK_SIZE, NULL, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, cameraBuffer);
+                cameraViewMatrixSet = false;
+                cameraProjectionMatrixSet = false;
+            }
+        }
+    }
+#endif
+    
+    // only the time spent blocked in Submit and here counts, not the gap in between
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    loadMilliseconds += std::chrono::duration<float, std::milli>(end - start).count();
+    buildMilliseconds = std::chrono::duration<float, std::milli>(end - submitTime).count();
+    if(loadedFromCache) {
+        std::cout << "Loaded shader program from cache in " << buildMilliseconds << " ms, saved " <<
+            (cacheCompileMilliseconds - buildMilliseconds) << " ms over compiling (" << cacheCompileMilliseconds << " ms)" << std::endl;
+    } else {
+        SaveCachedBinary(vertexShaderFile.c_str(), fragmentShaderFile.c_str(), vertexSource, fragmentSource);
+    }
+    vertexSource.clear();
+    fragmentSource.clear();
 	
 	SetColor(1.0f, 1.0f, 1.0f, 1.0f);
     
 }
 
+void ShaderProgram::Link(const std::string &vertexSource, const std::string &fragmentSource) {
+    // create the vertex shader
+    vertexShader = LoadShaderFromString(vertexSource, GL_VERTEX_SHADER);
+    // create the fragment shader
+    fragmentShader = LoadShaderFromString(fragmentSource, GL_FRAGMENT_SHADER);
+    
+    // Create the final shader program from our vertex and fragment shaders
+    programID = glCreateProgram();
+    glAttachShader(programID, vertexShader);
+    glAttachShader(programID, fragmentShader);
+#ifdef _WINDOWS
+    if(BinaryCacheSupported()) {
+        // has to be set before linking or the driver may not keep the binary around
+        glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+#endif
+    glLinkProgram(programID);
+}
+
 void ShaderProgram::Cleanup() {
+    pending = false;
+    if(boundProgram == programID) {
+        boundProgram = 0;
+    }
+    for(size_t i = 0; i < programs.size(); i++) {
+        if(programs[i] == this) {
+            programs.erase(programs.begin() + i);
+            break;
+        }
+    }
+    layout.Cleanup();
+    packedLayout.Cleanup();
     glDeleteProgram(programID);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+#ifdef _WINDOWS
+    if(programs.empty() && cameraBuffer != 0) {
+        // the last program is gone, nothing reads the camera block any more
+        glDeleteBuffers(1, &cameraBuffer);
+        cameraBuffer = 0;
+    }
+#endif
 }
 
-GLuint ShaderProgram::LoadShaderFromFile(const std::string &shaderFile, GLenum type) {
+std::string ShaderProgram::ReadShaderFile(const std::string &shaderFile) {
     //Open a file stream with the file name
     std::ifstream infile(shaderFile);
     
@@ -49,9 +216,12 @@ GLuint ShaderProgram::LoadShaderFromFile(const std::string &shaderFile, GLenum t
     //Create a string buffer and stream the file to it
     std::stringstream buffer;
     buffer << infile.rdbuf();
-    
+    return buffer.str();
+}
+
+GLuint ShaderProgram::LoadShaderFromFile(const std::string &shaderFile, GLenum type) {
     // Load the shader from the contents of the file
-    return LoadShaderFromString(buffer.str(), type);
+    return LoadShaderFromString(ReadShaderFile(shaderFile), type);
 }
 
 GLuint ShaderProgram::LoadShaderFromString(const std::string &shaderContents, GLenum type) {
@@ -64,10 +234,18 @@ GLuint ShaderProgram::LoadShaderFromString(const std::string &shaderContents, GL
     const char *shaderString = shaderContents.c_str();
     GLint shaderStringLength = (GLint) shaderContents.size();
     
-    // Set the shader source to the string and compile shader
-    glShaderSource(shaderID, 1, &shaderString, &shaderStringLength);
+    // Set the shader source to the string and compile shader, the #extension line has to come first
+    const char *preamble = usesCameraBlock ? cameraBlockPreamble : "";
+    const char *strings[] = { preamble, defines.c_str(), shaderString };
+    GLint lengths[] = { (GLint)strlen(preamble), (GLint)defines.size(), shaderStringLength };
+    glShaderSource(shaderID, 3, strings, lengths);
     glCompileShader(shaderID);
     
+    // the compile status is left for Finish, asking for it here would wait on the compile
+    return shaderID;
+}
+
+bool ShaderProgram::CheckShader(GLuint shaderID) {
     // Check if the shader compiled properly
     GLint compileSuccess;
     glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compileSuccess);
@@ -78,27 +256,290 @@ GLuint ShaderProgram::LoadShaderFromString(const std::string &shaderContents, GL
         glGetShaderInfoLog(shaderID, sizeof(messages), 0, &messages[0]);
         std::cout << messages << std::endl;
     }
-    
-    // return the shader id
-    return shaderID;
+    return compileSuccess == GL_TRUE;
+}
+
+void ShaderProgram::Use() {
+    if(pending) {
+        Finish();
+    }
+    if(boundProgram == programID) {
+        skippedCalls++;
+        return;
+    }
+    glUseProgram(programID);
+    boundProgram = programID;
 }
 
 void ShaderProgram::SetColor(float r, float g, float b, float a) {
-	glUseProgram(programID);
-	glUniform4f(colorUniform, r, g, b, a);
+    if(pending) {
+        Finish();
+    }
+    if(colorSet && color[0] == r && color[1] == g && color[2] == b && color[3] == a) {
+        skippedCalls += 2;
+        return;
+    }
+    Use();
+    glUniform4f(colorUniform, r, g, b, a);
+    color[0] = r;
+    color[1] = g;
+    color[2] = b;
+    color[3] = a;
+    colorSet = true;
+}
+
+// uploads matrix to uniform unless it matches the shadow copy of what is already there
+static void UploadMatrix(ShaderProgram &program, GLuint uniform, const Matrix &matrix, Matrix &shadow, bool &shadowSet) {
+    if(shadowSet && memcmp(shadow.ml, matrix.ml, sizeof(matrix.ml)) == 0) {
+        ShaderProgram::skippedCalls += 2;
+        return;
+    }
+    program.Use();
+    glUniformMatrix4fv(uniform, 1, GL_FALSE, matrix.ml);
+    shadow = matrix;
+    shadowSet = true;
+}
+
+// writes one matrix of the Camera block unless the buffer already holds it
+static void UploadCameraMatrix(GLintptr offset, const Matrix &matrix, Matrix &shadow, bool &shadowSet) {
+    if(shadowSet && memcmp(shadow.ml, matrix.ml, sizeof(matrix.ml)) == 0) {
+        ShaderProgram::skippedCalls++;
+        return;
+    }
+#ifdef _WINDOWS
+    glBindBuffer(GL_UNIFORM_BUFFER, ShaderProgram::cameraBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(matrix.ml), matrix.ml);
+#else
+    (void)offset;
+#endif
+    shadow = matrix;
+    shadowSet = true;
 }
 
 void ShaderProgram::SetViewMatrix(const Matrix &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(viewMatrixUniform, 1, GL_FALSE, matrix.ml);
+    if(pending) {
+        // the uniform locations aren't known until the program is finished
+        Finish();
+    }
+    if(usesCameraBlock) {
+        UploadCameraMatrix(CAMERA_VIEW_OFFSET, matrix, cameraViewMatrix, cameraViewMatrixSet);
+    } else {
+        UploadMatrix(*this, viewMatrixUniform, matrix, viewMatrix, viewMatrixSet);
+    }
 }
 
 void ShaderProgram::SetModelMatrix(const Matrix &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, matrix.ml);
+    if(pending) {
+        Finish();
+    }
+    UploadMatrix(*this, modelMatrixUniform, matrix, modelMatrix, modelMatrixSet);
+    modelNode = nullptr;
+}
+
+void ShaderProgram::SetModelMatrix(const Transform2D &transform) {
+    // expand to a full 4x4 only here, at the upload
+    Matrix matrix;
+    transform.ToMatrix(matrix);
+    SetModelMatrix(matrix);
+}
+
+void ShaderProgram::SetModelMatrix(TransformNode &node) {
+    const Matrix &matrix = node.GetWorldMatrix();
+    if(!pending && modelMatrixSet && modelNode == &node && modelNodeVersion == node.worldVersion) {
+        skippedCalls += 2;
+        return;
+    }
+    SetModelMatrix(matrix);
+    modelNode = &node;
+    modelNodeVersion = node.worldVersion;
 }
 
 void ShaderProgram::SetProjectionMatrix(const Matrix &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(projectionMatrixUniform, 1, GL_FALSE, matrix.ml);    
+    if(pending) {
+        Finish();
+    }
+    if(usesCameraBlock) {
+        UploadCameraMatrix(CAMERA_PROJECTION_OFFSET, matrix, cameraProjectionMatrix, cameraProjectionMatrixSet);
+    } else {
+        UploadMatrix(*this, projectionMatrixUniform, matrix, projectionMatrix, projectionMatrixSet);
+    }
+}
+
+void ShaderProgram::SetCamera(const Matrix &viewMatrix, const Matrix &projectionMatrix) {
+    // programs on the shared block all hit the same shadow copy, so only the first one uploads
+    for(size_t i = 0; i < programs.size(); i++) {
+        programs[i]->SetViewMatrix(viewMatrix);
+        programs[i]->SetProjectionMatrix(projectionMatrix);
+    }
+}
+
+bool ShaderProgram::CameraBlockSupported() {
+#ifdef _WINDOWS
+    return GLEW_ARB_uniform_buffer_object != 0;
+#else
+    return false;
+#endif
+}
+
+bool ShaderProgram::BinaryCacheSupported() {
+#ifdef _WINDOWS
+    if(!GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    // drivers can expose the extension with no formats, then there is nothing to save
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+#else
+    return false;
+#endif
+}
+
+// FNV-1a, only used to tell cache files apart so it doesn't need to be strong
+static unsigned long long HashBytes(unsigned long long hash, const char *data, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static unsigned long long HashString(unsigned long long hash, const char *string) {
+    // hash the terminator too so "ab"+"c" and "a"+"bc" differ
+    return HashBytes(hash, string ? string : "", string ? strlen(string) + 1 : 1);
+}
+
+#define SHADER_CACHE_MAGIC 0x43425053
+#define SHADER_CACHE_VERSION 2
+
+// header in front of the driver's program binary
+struct ShaderCacheHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long key;
+    unsigned int binaryFormat;
+    unsigned int binaryLength;
+    float compileMilliseconds;
+};
+
+std::string ShaderProgram::cacheDirectory = "";
+
+std::string ShaderProgram::CacheFile(const char *vertexShaderFile, const char *fragmentShaderFile) const {
+    // one file per shader pair, block mode and defines, a stale one just gets overwritten
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = HashString(hash, vertexShaderFile);
+    hash = HashString(hash, fragmentShaderFile);
+    hash = HashString(hash, usesCameraBlock ? cameraBlockPreamble : "");
+    hash = HashString(hash, defines.c_str());
+    char name[64];
+    snprintf(name, sizeof(name), "shadercache_%016llx.bin", hash);
+    return cacheDirectory + name;
+}
+
+unsigned long long ShaderProgram::CacheKey(const std::string &vertexSource, const std::string &fragmentSource) const {
+    // binaries only load on the exact driver that made them, so the driver strings go into the key
+    unsigned long long key = 14695981039346656037ULL;
+    key = HashString(key, usesCameraBlock ? cameraBlockPreamble : "");
+    key = HashString(key, defines.c_str());
+    key = HashString(key, vertexSource.c_str());
+    key = HashString(key, fragmentSource.c_str());
+    key = HashString(key, (const char *)glGetString(GL_VENDOR));
+    key = HashString(key, (const char *)glGetString(GL_RENDERER));
+    key = HashString(key, (const char *)glGetString(GL_VERSION));
+    return key;
+}
+
+bool ShaderProgram::LoadCachedBinary(const char *vertexShaderFile, const char *fragmentShaderFile, const std::string &vertexSource, const std::string &fragmentSource) {
+#ifdef _WINDOWS
+    if(!BinaryCacheSupported()) {
+        return false;
+    }
+    std::ifstream infile(CacheFile(vertexShaderFile, fragmentShaderFile), std::ios::binary);
+    if(infile.fail()) {
+        return false;
+    }
+    ShaderCacheHeader header;
+    if(!infile.read((char *)&header, sizeof(header)) || header.magic != SHADER_CACHE_MAGIC ||
+       header.version != SHADER_CACHE_VERSION || header.key != CacheKey(vertexSource, fragmentSource)) {
+        return false;
+    }
+    std::vector<char> binary(header.binaryLength);
+    if(!infile.read(binary.data(), binary.size())) {
+        return false;
+    }
+    
+    programID = glCreateProgram();
+    glProgramBinary(programID, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+    // whether the driver took it is checked in Finish
+    cacheCompileMilliseconds = header.compileMilliseconds;
+    return true;
+#else
+    (void)vertexShaderFile;
+    (void)fragmentShaderFile;
+    (void)vertexSource;
+    (void)fragmentSource;
+    return false;
+#endif
+}
+
+void ShaderProgram::SaveCachedBinary(const char *vertexShaderFile, const char *fragmentShaderFile, const std::string &vertexSource, const std::string &fragmentSource) {
+#ifdef _WINDOWS
+    GLint linkSuccess;
+    glGetProgramiv(programID, GL_LINK_STATUS, &linkSuccess);
+    if(!BinaryCacheSupported() || linkSuccess == GL_FALSE) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum binaryFormat;
+    glGetProgramBinary(programID, length, &length, &binaryFormat, binary.data());
+    
+    ShaderCacheHeader header;
+    header.magic = SHADER_CACHE_MAGIC;
+    header.version = SHADER_CACHE_VERSION;
+    header.key = CacheKey(vertexSource, fragmentSource);
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = (unsigned int)length;
+    header.compileMilliseconds = buildMilliseconds;
+    
+    std::ofstream outfile(CacheFile(vertexShaderFile, fragmentShaderFile), std::ios::binary | std::ios::trunc);
+    if(outfile.fail()) {
+        return;
+    }
+    outfile.write((const char *)&header, sizeof(header));
+    outfile.write(binary.data(), length);
+#else
+    (void)vertexShaderFile;
+    (void)fragmentShaderFile;
+    (void)vertexSource;
+    (void)fragmentSource;
+#endif
+}
+
+bool ShaderProgram::ParallelCompileSupported() {
+#ifdef _WINDOWS
+    return GLEW_ARB_parallel_shader_compile || GLEW_KHR_parallel_shader_compile;
+#else
+    return false;
+#endif
+}
+
+void ShaderProgram::EnableParallelCompile() {
+#ifdef _WINDOWS
+    static bool enabled = false;
+    if(enabled) {
+        return;
+    }
+    enabled = true;
+    // let the driver pick the thread count
+    if(GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    } else if(GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+#endif
 }
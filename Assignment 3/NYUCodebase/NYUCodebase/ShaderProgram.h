@@ -8,21 +8,63 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
+#include <chrono>
 #include "Matrix.h"
+#include "Transform2D.h"
+#include "TransformNode.h"
+#include "VertexLayout.h"
 
 class ShaderProgram {
     public:
-	void Load(const char *vertexShaderFile, const char *fragmentShaderFile);
+	void Load(const char *vertexShaderFile, const char *fragmentShaderFile, const std::string &defines = "");
+    
+        // Load split in two. Submit only queues the compile and link, Finish checks the status and
+        // logs and looks up the locations. Use and the setters call Finish on their own, so submit every
+        // program early and load the rest of the game while the driver compiles.
+        // defines are #define lines put in front of both sources, to build variants of one shader pair
+        void Submit(const char *vertexShaderFile, const char *fragmentShaderFile, const std::string &defines = "");
+        void Finish();
+        // true once Finish won't block, always true without parallel compile support
+        bool IsReady();
+        static bool ParallelCompileSupported();
+        static void EnableParallelCompile();
 	void Cleanup();   
 
+        // binds the program unless it is already the bound one
+        void Use();
+
         void SetModelMatrix(const Matrix &matrix);
+        void SetModelMatrix(const Transform2D &transform);
+        // the node's world matrix, skipped without even comparing it when this program already has
+        // the node's matrix from the same worldVersion, which is every frame for static geometry
+        void SetModelMatrix(TransformNode &node);
         void SetProjectionMatrix(const Matrix &matrix);
         void SetViewMatrix(const Matrix &matrix);
+    
+        // sets view and projection for every loaded program. programs reading the Camera
+        // uniform block share one buffer, so this is a single upload no matter how many there are
+        static void SetCamera(const Matrix &viewMatrix, const Matrix &projectionMatrix);
+        static bool CameraBlockSupported();
 	
 		void SetColor(float r, float g, float b, float a);
 	
         GLuint LoadShaderFromString(const std::string &shaderContents, GLenum type);
         GLuint LoadShaderFromFile(const std::string &shaderFile, GLenum type);
+        static std::string ReadShaderFile(const std::string &shaderFile);
+        // prints the info log if the shader failed to compile
+        static bool CheckShader(GLuint shaderID);
+        void Link(const std::string &vertexSource, const std::string &fragmentSource);
+    
+        // linked program binaries are cached on disk, keyed by the sources and the driver strings.
+        // a missing, stale or rejected cache file falls back to compiling from source
+        static bool BinaryCacheSupported();
+        bool LoadCachedBinary(const char *vertexShaderFile, const char *fragmentShaderFile, const std::string &vertexSource, const std::string &fragmentSource);
+        void SaveCachedBinary(const char *vertexShaderFile, const char *fragmentShaderFile, const std::string &vertexSource, const std::string &fragmentSource);
+        std::string CacheFile(const char *vertexShaderFile, const char *fragmentShaderFile) const;
+        unsigned long long CacheKey(const std::string &vertexSource, const std::string &fragmentSource) const;
+        // where the cache files go, empty is the working directory
+        static std::string cacheDirectory;
     
         GLuint programID;
     
@@ -33,7 +75,59 @@ class ShaderProgram {
 	
         GLuint positionAttribute;
         GLuint texCoordAttribute;
+        // position and texCoord as two float2 arrays, the format every draw in the games uses.
+        // attribute 0 is position, 1 texCoord, which the untextured shader doesn't have
+        VertexLayout layout;
+        // the same two attributes interleaved as a PackedVertex
+        VertexLayout packedLayout;
     
         GLuint vertexShader;
         GLuint fragmentShader;
+    
+        // time spent blocked in Submit and Finish
+        float loadMilliseconds;
+        // time from Submit until Finish was done, the background compile included. the cache keeps the
+        // one from compiling, a cache hit measures its own the same way to report what it saved
+        std::chrono::steady_clock::time_point submitTime;
+        float buildMilliseconds;
+        float cacheCompileMilliseconds;
+        bool loadedFromCache;
+    
+        // submitted but not finished yet, the sources are kept for the cache key and a rebuild
+        bool pending;
+        std::string vertexShaderFile;
+        std::string fragmentShaderFile;
+        std::string vertexSource;
+        std::string fragmentSource;
+        std::string defines;
+    
+        // last values uploaded to this program, setters skip the GL calls when nothing changed
+        Matrix modelMatrix;
+        Matrix viewMatrix;
+        Matrix projectionMatrix;
+        float color[4];
+        bool modelMatrixSet;
+        // node the model matrix came from and its worldVersion then, nullptr after a plain matrix
+        const TransformNode *modelNode;
+        unsigned int modelNodeVersion;
+        bool viewMatrixSet;
+        bool projectionMatrixSet;
+        bool colorSet;
+    
+        // view and projection come from the shared camera buffer instead of this program's uniforms.
+        // the buffer is made by the first program that needs it and deleted with the last one
+        bool usesCameraBlock;
+        static GLuint cameraBuffer;
+        static Matrix cameraViewMatrix;
+        static Matrix cameraProjectionMatrix;
+        static bool cameraViewMatrixSet;
+        static bool cameraProjectionMatrixSet;
+    
+        // every loaded program, so SetCamera can reach the ones without the camera block
+        static std::vector<ShaderProgram *> programs;
+    
+        // program bound through Use(), bind programs through Use() too or this goes stale
+        static GLuint boundProgram;
+        // glUseProgram and glUniform calls skipped because the state was already there
+        static unsigned long long skippedCalls;
 };
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <string>
+#include <deque>
+#include <set>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// loads textures without stalling the main thread. Load hands back a texture name right away and
+// queues the file for a pool of worker threads that run stbi_load. Update, called once a frame on
+// the GL thread, copies what has been decoded into pixel buffer objects, and the next Update
+// points the textures at them, so the driver has a frame to finish one copy before the other
+// needs it. Without pixel buffers Update uploads from the decoded memory directly. Until IsReady the
+// texture has no storage and samples as black, so keep it off screen. The loader owns the textures
+// it hands out, they're deleted in Cleanup
+class TextureLoader {
+    public:
+
+        // threadCount 0 picks one less than the number of cores
+        TextureLoader(int threadCount = 0);
+        ~TextureLoader();
+
+        GLuint Load(const std::string &filePath);
+        // finishes the uploads the last Update staged, then stages decoded images until uploadBudget
+        // bytes went out, always at least one
+        void Update(size_t uploadBudget = 8 * 1024 * 1024);
+        // blocks until every queued texture is uploaded
+        void Finish();
+        void Cleanup();
+
+        bool IsReady(GLuint texture) const;
+        bool Done() const;
+        static bool PixelBufferSupported();
+
+        struct Job {
+            std::string filePath;
+            GLuint texture;
+        };
+
+        struct DecodedImage {
+            std::string filePath;
+            GLuint texture;
+            int width, height;
+            unsigned char *pixels;
+        };
+
+        // an image copied into a pixel buffer, waiting for the next Update to go into its texture
+        struct StagedImage {
+            GLuint texture;
+            int width, height;
+            GLuint pixelBuffer;
+        };
+
+        void WorkerLoop();
+        void StopWorkers();
+        // false when the image went straight into its texture instead
+        bool Stage(const DecodedImage &image);
+        void Upload(const StagedImage &image);
+        static void SetFilters(GLuint texture);
+
+        std::vector<std::thread> workers;
+        // jobs and decoded are shared with the workers, everything else is main thread only
+        std::mutex mutex;
+        std::condition_variable jobQueued;
+        std::condition_variable imageDecoded;
+        std::deque<Job> jobs;
+        std::deque<DecodedImage> decoded;
+        bool stopping;
+
+        // every texture Load handed out, and the ones of them that aren't uploaded yet
+        std::vector<GLuint> textures;
+        std::set<GLuint> pending;
+        std::deque<StagedImage> staged;
+        // one per image staged in the same Update, each goes back to free once its upload is issued
+        std::vector<GLuint> pixelBuffers;
+        std::vector<GLuint> freePixelBuffers;
+};
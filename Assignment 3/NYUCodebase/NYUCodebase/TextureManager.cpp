@@ -0,0 +1,101 @@
+#include "TextureManager.h"
+#include "CookedTexture.h"
+#include "stb_image.h"
+#include <stdio.h>
+
+TextureManager::TextureManager(size_t budgetBytes) : budgetBytes(budgetBytes), gpuBytes(0), useClock(0), hits(0), misses(0), evictions(0) {}
+
+GLuint TextureManager::Acquire(const std::string &filePath) {
+    std::map<std::string, Entry>::iterator it = entries.find(filePath);
+    if(it != entries.end()) {
+        hits++;
+        it->second.references++;
+        it->second.lastUsed = ++useClock;
+        return it->second.texture;
+    }
+
+    // a cooked .ctex next to the image skips the PNG decode and brings its mip chain
+    Entry entry;
+    entry.texture = CookedTexture::Load(CookedTexture::CookedPath(filePath), &entry.width, &entry.height, &entry.bytes);
+    if(entry.texture == 0) {
+        int comp;
+        unsigned char *image = stbi_load(filePath.c_str(), &entry.width, &entry.height, &comp, STBI_rgb_alpha);
+        if(image == NULL) {
+            printf("Unable to load image %s. Make sure the path is correct\n", filePath.c_str());
+            return 0;
+        }
+        glGenTextures(1, &entry.texture);
+        glBindTexture(GL_TEXTURE_2D, entry.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, entry.width, entry.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        stbi_image_free(image);
+        entry.bytes = (size_t)entry.width * entry.height * 4;
+    }
+    misses++;
+
+    entry.references = 1;
+    entry.lastUsed = ++useClock;
+    entries[filePath] = entry;
+    paths[entry.texture] = filePath;
+    gpuBytes += entry.bytes;
+
+    Evict();
+    return entry.texture;
+}
+
+void TextureManager::Release(GLuint texture) {
+    std::map<GLuint, std::string>::iterator it = paths.find(texture);
+    if(it == paths.end()) {
+        return;
+    }
+    Entry &entry = entries[it->second];
+    if(entry.references > 0) {
+        entry.references--;
+    }
+    if(entry.references == 0 && gpuBytes > budgetBytes) {
+        Evict();
+    }
+}
+
+void TextureManager::Touch(GLuint texture) {
+    std::map<GLuint, std::string>::iterator it = paths.find(texture);
+    if(it != paths.end()) {
+        entries[it->second].lastUsed = ++useClock;
+    }
+}
+
+void TextureManager::SetBudget(size_t budgetBytes) {
+    this->budgetBytes = budgetBytes;
+    Evict();
+}
+
+void TextureManager::Evict() {
+    while(gpuBytes > budgetBytes) {
+        // the cache holds a handful of textures, a scan for the oldest is cheaper than keeping a list
+        std::map<std::string, Entry>::iterator oldest = entries.end();
+        for(std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); it++) {
+            if(it->second.references == 0 && (oldest == entries.end() || it->second.lastUsed < oldest->second.lastUsed)) {
+                oldest = it;
+            }
+        }
+        if(oldest == entries.end()) {
+            // everything left is in use
+            return;
+        }
+        glDeleteTextures(1, &oldest->second.texture);
+        gpuBytes -= oldest->second.bytes;
+        paths.erase(oldest->second.texture);
+        entries.erase(oldest);
+        evictions++;
+    }
+}
+
+void TextureManager::Cleanup() {
+    for(std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); it++) {
+        glDeleteTextures(1, &it->second.texture);
+    }
+    entries.clear();
+    paths.clear();
+    gpuBytes = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <stddef.h>
+
+#define VERTEX_RING_REGIONS 3
+
+// one GPU buffer that per frame vertex data is streamed through instead of client arrays.
+// With ARB_buffer_storage the buffer is mapped once for good and split in three regions, a frame
+// writes into its own region while the GPU may still read the two before it, and a fence per region
+// makes sure it never writes into one the GPU hasn't finished. Without it the buffer is a single
+// region written with glBufferSubData and orphaned at the end of every frame.
+//
+//  ring.Reserve(sizeof(vertices) + sizeof(texCoords), 2);
+//  glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, ring.Stream(vertices, sizeof(vertices)));
+//  ...
+//  glDrawArrays(GL_TRIANGLES, 0, 6);
+//  ring.Unbind();
+//
+// and ring.EndFrame() once a frame, after the swap. Regions only change in Reserve and EndFrame,
+// between draws, so a region's fence always comes after the last draw that reads it.
+class VertexRing {
+    public:
+
+        // nothing is created until the first Stream, so a global ring is fine
+        VertexRing(size_t regionBytes = 4 * 1024 * 1024);
+
+        // call before a draw's Stream calls with the bytes they add up to. when the rest of the region
+        // is too small it moves on to the next one now, before any of the draw's data is written, so
+        // the draw never straddles two regions. returns false when the data won't go in the buffer
+        // and Stream will hand back client memory, for draws that have to know that up front
+        bool Reserve(size_t bytes, int streams = 1);
+        // copies the data into the ring and binds it to GL_ARRAY_BUFFER. returns what to hand to
+        // glVertexAttribPointer: an offset into the ring, or data itself with no buffer bound
+        // when it's bigger than a region, it wasn't reserved and the region is full, or there are no buffers
+        const void *Stream(const void *data, size_t bytes);
+        // back to client arrays
+        void Unbind();
+        // fences this frame's region and moves to the next one, or orphans the buffer
+        void EndFrame();
+        void Cleanup();
+
+        static bool Supported();
+        static bool PersistentSupported();
+
+        GLuint buffer;
+        bool persistent;
+        unsigned char *mapped;
+        size_t regionBytes;
+        int region;
+        // next free byte in the region, or in the whole buffer when orphaning
+        size_t head;
+#ifdef _WINDOWS
+        GLsync fences[VERTEX_RING_REGIONS];
+#endif
+
+        unsigned long long bytesStreamed;
+        // times a region was still in use by the GPU and Reserve had to wait for it
+        int fenceWaits;
+        int orphans;
+
+    private:
+        void Create();
+        void NextRegion();
+};
@@ -7,7 +7,10 @@
 #include <SDL_opengl.h>
 #include <SDL_image.h>
 #include "ShaderProgram.h"
+#include "TextureManager.h"
 #include "Matrix.h"
+#include "QuadIndexBuffer.h"
+#include "VertexRing.h"
 #include "stb_image.h"
 #include <vector>
 #include <windows.h>
@@ -31,21 +34,17 @@
 
 SDL_Window* displayWindow;
 
+//Every texture goes through the manager, so loading the same file twice shares one texture
+TextureManager textureManager;
+
+//Every frame's vertices are streamed through this instead of being copied out of client arrays by the driver
+VertexRing vertexRing;
+
 //Function to load texture as unsigned int
 GLuint LoadTexture(const char *filePath) {
-	int w, h, comp;
-	unsigned char* image = stbi_load(filePath, &w, &h, &comp, STBI_rgb_alpha);
-	if (image == NULL) {
-		std::cout << "Unable to load image. Make sure the path is correct\n";
-		assert(false);
-	}
-	GLuint retTexture;
-	glGenTextures(1, &retTexture);
-	glBindTexture(GL_TEXTURE_2D, retTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	stbi_image_free(image);
+	GLuint retTexture = textureManager.Acquire(filePath);
+	//Acquire already printed which file failed
+	assert(retTexture != 0);
 	return retTexture;
 }
 
@@ -69,12 +68,11 @@ public:
 void SheetSprite::Draw(ShaderProgram *program) {
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
+	//Corners in the shared index buffer's order: bottom left, top right, top left, bottom right
 	GLfloat texCoords[] = {
 		u, v + height,
 		u + width, v,
 		u, v,
-		u + width, v,
-		u, v + height,
 		u + width, v + height
 	};
 
@@ -83,19 +81,16 @@ void SheetSprite::Draw(ShaderProgram *program) {
 		-0.5f * size * aspect, -0.5f * size,
 		0.5f * size * aspect, 0.5f * size,
 		-0.5f * size * aspect, 0.5f * size,
-		0.5f * size * aspect, 0.5f * size,
-		-0.5f * size * aspect, -0.5f * size,
 		0.5f * size * aspect, -0.5f * size
 	};
 
 	//draw our arrays
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertices);
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoords);
-	glEnableVertexAttribArray(program->texCoordAttribute);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
+	program->layout.Bind(!vertexRing.Reserve(sizeof(vertices) + sizeof(texCoords), 2));
+	program->layout.Pointer(0, vertexRing.Stream(vertices, sizeof(vertices)));
+	program->layout.Pointer(1, vertexRing.Stream(texCoords, sizeof(texCoords)));
+	QuadIndexBuffer::Shared().Draw(1, 4 * sizeof(float));
+	program->layout.Unbind();
+	vertexRing.Unbind();
 }
 
 
@@ -107,21 +102,18 @@ void DrawText(ShaderProgram *program, int fontTexture, std::string text, float s
 		int spriteIndex = (int)text[i];
 		float texture_x = (float)(spriteIndex % 16) / 16.0f;
 		float texture_y = (float)(spriteIndex / 16) / 16.0f;
+		//Bottom left, top right, top left, bottom right, the index buffer makes the triangles
 		vertexData.insert(vertexData.end(), {
-			((size + spacing) * i) + (-0.5f * size), 0.5f * size,
 			((size + spacing) * i) + (-0.5f * size), -0.5f * size,
 			((size + spacing) * i) + (0.5f * size), 0.5f * size,
+			((size + spacing) * i) + (-0.5f * size), 0.5f * size,
 			((size + spacing) * i) + (0.5f * size), -0.5f * size,
-			((size + spacing) * i) + (0.5f * size), 0.5f * size,
-			((size + spacing) * i) + (-0.5f * size), -0.5f * size,
 			});
 		texCoordData.insert(texCoordData.end(), {
-			texture_x, texture_y,
 			texture_x, texture_y + texture_size,
 			texture_x + texture_size, texture_y,
+			texture_x, texture_y,
 			texture_x + texture_size, texture_y + texture_size,
-			texture_x + texture_size, texture_y,
-			texture_x, texture_y + texture_size,
 			});
 	}
 	glBindTexture(GL_TEXTURE_2D, fontTexture);
@@ -129,15 +121,14 @@ void DrawText(ShaderProgram *program, int fontTexture, std::string text, float s
 	glEnable(GL_BLEND);
 
 	// draw this data (use the .data() method of std::vector to get pointer to data)
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertexData.data());
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoordData.data());
-	glEnableVertexAttribArray(program->texCoordAttribute);
+	program->layout.Bind(!vertexRing.Reserve(2 * vertexData.size() * sizeof(float), 2));
+	program->layout.Pointer(0, vertexRing.Stream(vertexData.data(), vertexData.size() * sizeof(float)));
+	program->layout.Pointer(1, vertexRing.Stream(texCoordData.data(), texCoordData.size() * sizeof(float)));
 
-	glDrawArrays(GL_TRIANGLES, 0, 6 * text.size());
+	QuadIndexBuffer::Shared().Draw(text.size(), 4 * sizeof(float));
 
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
+	program->layout.Unbind();
+	vertexRing.Unbind();
 
 }
 
@@ -388,7 +379,8 @@ int main(int argc, char *argv[])
 	//Load the shader program
 	ShaderProgram program;
 	//WE'RE GONNA WANT THE TEXTURED VERTEX SHADER AND FRAGMENT SHADER
-	program.Load(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
+	program.Submit(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
+	//Compiles in the background, it gets finished the first time the program is used
 
 	//Setting up the Sprite sheet
 	spriteSheetTexture = LoadTexture("sheet.png");
@@ -523,7 +515,7 @@ int main(int argc, char *argv[])
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		//Use the specified program ID
-		glUseProgram(program.programID);
+		program.Use();
 
 		//Pass the matrices to our program
 		program.SetModelMatrix(modelMatrix);
@@ -551,8 +543,13 @@ int main(int argc, char *argv[])
 		Render(&program);
 
 		SDL_GL_SwapWindow(displayWindow);
+		//Next frame writes to the next region of the ring
+		vertexRing.EndFrame();
 	}
 
+	textureManager.Cleanup();
+	vertexRing.Cleanup();
+	QuadIndexBuffer::Shared().Cleanup();
 	SDL_Quit();
 	return 0;
 }
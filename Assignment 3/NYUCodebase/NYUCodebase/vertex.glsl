@@ -1,8 +1,18 @@
 attribute vec4 position;
 
 uniform mat4 modelMatrix;
+
+// CAMERA_BLOCK is defined by ShaderProgram when the driver supports uniform buffers,
+// then view and projection come from one buffer shared by every program
+#ifdef CAMERA_BLOCK
+layout(std140) uniform Camera {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+};
+#else
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
+#endif
 
 void main()
 {
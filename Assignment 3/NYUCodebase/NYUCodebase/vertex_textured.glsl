@@ -1,15 +1,42 @@
 attribute vec4 position;
 attribute vec2 texCoord;
 
+// INSTANCED is defined for the instanced sprite program. position and texCoord are then the
+// corners of one unit quad shared by every sprite, and each sprite is placed by its own attributes
+#ifdef INSTANCED
+attribute vec4 instancePlacement; // x, y, width, height
+attribute float instanceRotation;
+attribute vec4 instanceTexRect; // u0, v0 top left, u1, v1 bottom right
+#endif
+
 uniform mat4 modelMatrix;
+
+// CAMERA_BLOCK is defined by ShaderProgram when the driver supports uniform buffers,
+// then view and projection come from one buffer shared by every program
+#ifdef CAMERA_BLOCK
+layout(std140) uniform Camera {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+};
+#else
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
+#endif
 
 varying vec2 texCoordVar;
 
 void main()
 {
+#ifdef INSTANCED
+	vec2 corner = position.xy * instancePlacement.zw;
+	float s = sin(instanceRotation);
+	float c = cos(instanceRotation);
+	vec4 world = vec4(instancePlacement.xy + vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y), 0.0, 1.0);
+	vec4 p = viewMatrix * modelMatrix * world;
+	texCoordVar = mix(instanceTexRect.xy, instanceTexRect.zw, texCoord);
+#else
 	vec4 p = viewMatrix * modelMatrix  * position;
     texCoordVar = texCoord;
+#endif
 	gl_Position = projectionMatrix * p;
-}
\ No newline at end of file
+}
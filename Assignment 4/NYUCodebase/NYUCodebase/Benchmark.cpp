@@ -0,0 +1,632 @@
+
+#include "Benchmark.h"
+#include "stb_image.h"
+#include <stdio.h>
+#include <fstream>
+#include <iterator>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+Benchmark::Benchmark(long long warmupIterations, long long iterations) : warmupIterations(warmupIterations), iterations(iterations), sink(0.0f) {}
+
+void Benchmark::PrintResults() const {
+    printf("%-32s %12s %14s %16s %12s\n", "benchmark", "ns/op", "ops/sec", "items/sec", "bytes/op");
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult &result = results[i];
+        printf("%-32s %12.2f %14.0f %16.0f %12.0f\n", result.name.c_str(), result.nsPerOp, result.opsPerSecond, result.itemsPerSecond, result.bytesPerOp);
+    }
+}
+
+bool Benchmark::WriteJSON(const char *filePath) const {
+    FILE *file = fopen(filePath, "w");
+    if(file == NULL) {
+        printf("Error opening benchmark output file: %s\n", filePath);
+        return false;
+    }
+    fprintf(file, "{\n");
+    fprintf(file, "  \"warmup_iterations\": %lld,\n", warmupIterations);
+    fprintf(file, "  \"iterations\": %lld,\n", iterations);
+    fprintf(file, "  \"results\": [\n");
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult &result = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f, \"items_per_op\": %d, \"items_per_sec\": %.1f, \"bytes_per_op\": %.1f}%s\n",
+            result.name.c_str(), result.iterations, result.nsPerOp, result.opsPerSecond, result.itemsPerOp, result.itemsPerSecond, result.bytesPerOp,
+            i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+    fclose(file);
+    return true;
+}
+
+void RunMatrixBenchmarks(Benchmark &benchmark) {
+    // results are fed back into the inputs so nothing can be hoisted out of the loop
+    Matrix a;
+    a.Translate(0.5f, -0.25f, 0.0f);
+    a.Roll(0.3f);
+    Matrix b;
+    b.Roll(0.001f);
+    Matrix r;
+    
+    benchmark.Run("Matrix::operator*", [&]() {
+        a = a * b;
+        benchmark.sink = a.ml[0];
+    });
+    benchmark.Run("Matrix::MultiplyScalar", [&]() {
+        Matrix::MultiplyScalar(a, b, r);
+        a.m[3][0] = r.m[3][0];
+        benchmark.sink = r.ml[0];
+    });
+#ifdef MATRIX_X86
+    if(Matrix::HasSSE()) {
+        benchmark.Run("Matrix::MultiplySSE", [&]() {
+            Matrix::MultiplySSE(a, b, r);
+            a.m[3][0] = r.m[3][0];
+            benchmark.sink = r.ml[0];
+        });
+    }
+    if(Matrix::HasAVX()) {
+        benchmark.Run("Matrix::MultiplyAVX", [&]() {
+            Matrix::MultiplyAVX(a, b, r);
+            a.m[3][0] = r.m[3][0];
+            benchmark.sink = r.ml[0];
+        });
+    }
+#endif
+    
+    Matrix perspective = Matrix::PerspectiveProjection(1.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+    benchmark.Run("Matrix::Inverse (general)", [&]() {
+        r = perspective.Inverse();
+        perspective.m[3][2] += r.m[3][2] * 1.0e-9f;
+        benchmark.sink = r.ml[0];
+    });
+    benchmark.Run("Matrix::Inverse (affine)", [&]() {
+        r = a.Inverse();
+        a.m[3][0] += r.m[3][0] * 1.0e-9f;
+        benchmark.sink = r.ml[0];
+    });
+    benchmark.Run("Matrix::InverseScalar", [&]() {
+        r = a.InverseScalar();
+        a.m[3][0] += r.m[3][0] * 1.0e-9f;
+        benchmark.sink = r.ml[0];
+    });
+    
+    Matrix model;
+    benchmark.Run("Matrix::Translate", [&]() {
+        model.Translate(0.001f, 0.0f, 0.0f);
+        benchmark.sink = model.m[3][0];
+    });
+    benchmark.Run("Matrix::Roll", [&]() {
+        model.Roll(0.001f);
+        benchmark.sink = model.m[0][0];
+    });
+    
+    float right = 5.33f;
+    benchmark.Run("Matrix::SetOrthoProjection", [&]() {
+        r.SetOrthoProjection(-right, right, -3.0f, 3.0f, -1.0f, 1.0f);
+        right += 1.0e-6f;
+        benchmark.sink = r.m[0][0];
+    });
+    
+    const int pointCount = 1024;
+    std::vector<float> points(pointCount * 2);
+    std::vector<float> pointsX(pointCount);
+    std::vector<float> pointsY(pointCount);
+    for(int i = 0; i < pointCount; i++) {
+        points[i * 2] = pointsX[i] = (float)(i % 32) * 0.1f;
+        points[i * 2 + 1] = pointsY[i] = (float)(i / 32) * 0.1f;
+    }
+    std::vector<float> transformed(pointCount * 2);
+    std::vector<float> transformedX(pointCount);
+    std::vector<float> transformedY(pointCount);
+    benchmark.Run("Matrix::TransformPoints", [&]() {
+        a.TransformPoints(points.data(), transformed.data(), pointCount);
+        benchmark.sink = transformed[pointCount];
+    }, pointCount);
+    benchmark.Run("Matrix::TransformPoints (SoA)", [&]() {
+        a.TransformPoints(pointsX.data(), pointsY.data(), transformedX.data(), transformedY.data(), pointCount);
+        benchmark.sink = transformedX[pointCount / 2];
+    }, pointCount);
+    
+    const int angleCount = 1024;
+    std::vector<float> angles(angleCount);
+    for(int i = 0; i < angleCount; i++) {
+        angles[i] = (float)i * 0.01f;
+    }
+    std::vector<float> sines(angleCount);
+    std::vector<float> cosines(angleCount);
+    bool fastTrig = Matrix::fastTrig;
+    Matrix::fastTrig = false;
+    benchmark.Run("Matrix::SinCos batch", [&]() {
+        Matrix::SinCos(angles.data(), sines.data(), cosines.data(), angleCount);
+        benchmark.sink = sines[angleCount / 2];
+    }, angleCount);
+    Matrix::fastTrig = true;
+    benchmark.Run("Matrix::SinCos batch (fast)", [&]() {
+        Matrix::SinCos(angles.data(), sines.data(), cosines.data(), angleCount);
+        benchmark.sink = sines[angleCount / 2];
+    }, angleCount);
+    Matrix::fastTrig = fastTrig;
+}
+
+// floats as integers that count up in step with them, so two floats' distance in ulps is a subtraction
+static long long OrderedBits(float f) {
+    int bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits < 0 ? -(long long)(bits & 0x7fffffff) : (long long)bits;
+}
+
+static long long UlpDistance(float a, float b) {
+    long long distance = OrderedBits(a) - OrderedBits(b);
+    return distance < 0 ? -distance : distance;
+}
+
+// one kind of comparison, counted over every matrix it ran on
+struct MatrixCheck {
+    const char *name;
+    // allowed distance between result and expected. scale is the size of the terms an element was
+    // summed from, results that cancel down near zero are held to maxUlps of that instead of their own
+    int maxUlps;
+    long long elements;
+    long long failures;
+    // the largest error seen, in whichever of the two measures was smaller
+    double worstUlps;
+};
+
+static MatrixCheck MakeCheck(const char *name, int maxUlps) {
+    MatrixCheck check = { name, maxUlps, 0, 0, 0.0 };
+    return check;
+}
+
+static void Check(MatrixCheck &check, const Matrix &result, const Matrix &expected, const Matrix &scale) {
+    for(int i = 0; i < 16; i++) {
+        check.elements++;
+        float a = result.ml[i];
+        float b = expected.ml[i];
+        if(a == b || (a != a && b != b)) {
+            continue;
+        }
+        long long ulps = UlpDistance(a, b);
+        double error = (double)ulps;
+        if(scale.ml[i] > 0.0f) {
+            error = fmin(error, fabs((double)a - (double)b) / (FLT_EPSILON * scale.ml[i]));
+        }
+        if(error > check.worstUlps) {
+            check.worstUlps = error;
+        }
+        if(error <= check.maxUlps) {
+            continue;
+        }
+        if(check.failures < 4) {
+            printf("  %s: element %d is %.9g, expected %.9g (%lld ulps)\n", check.name, i, a, b, ulps);
+        }
+        check.failures++;
+    }
+}
+
+// for checks on which path a matrix takes rather than its values, counted as one element
+static void CheckThat(MatrixCheck &check, bool condition, const char *what) {
+    check.elements++;
+    if(!condition) {
+        if(check.failures < 4) {
+            printf("  %s: %s\n", check.name, what);
+        }
+        check.failures++;
+    }
+}
+
+static bool Report(const MatrixCheck &check) {
+    printf("%-40s %8lld elements %6lld failed   worst %.2f ulps\n", check.name, check.elements, check.failures, check.worstUlps);
+    return check.failures == 0;
+}
+
+// xorshift with a fixed seed, a failure shows up on the same matrices every run
+static float SelfTestRandom(unsigned int &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (float)(state & 0xffffff) / (float)0x800000 - 1.0f;
+}
+
+static Matrix RandomMatrix(unsigned int &state, float magnitude) {
+    Matrix matrix;
+    for(int i = 0; i < 16; i++) {
+        matrix.ml[i] = SelfTestRandom(state) * magnitude;
+    }
+    return matrix;
+}
+
+// |a| * |b|, the size of the terms each element of a * b is summed from
+static Matrix ProductScale(const Matrix &a, const Matrix &b) {
+    Matrix scale;
+    for(int i = 0; i < 4; i++) {
+        for(int j = 0; j < 4; j++) {
+            float sum = 0.0f;
+            for(int k = 0; k < 4; k++) {
+                sum += fabsf(a.m[i][k] * b.m[k][j]);
+            }
+            scale.m[i][j] = sum;
+        }
+    }
+    return scale;
+}
+
+// every element sized like the largest one, for inverses, whose elements all come out of one determinant
+static Matrix LargestScale(const Matrix &matrix) {
+    float largest = 0.0f;
+    for(int i = 0; i < 16; i++) {
+        largest = fmaxf(largest, fabsf(matrix.ml[i]));
+    }
+    Matrix scale;
+    for(int i = 0; i < 16; i++) {
+        scale.ml[i] = largest;
+    }
+    return scale;
+}
+
+// random but well away from singular, a big diagonal keeps the condition number small
+static Matrix RandomInvertible(unsigned int &state) {
+    Matrix matrix = RandomMatrix(state, 1.0f);
+    for(int i = 0; i < 4; i++) {
+        matrix.m[i][i] += 4.0f;
+    }
+    return matrix;
+}
+
+// what a model or view matrix is built from
+static Matrix RandomAffine(unsigned int &state) {
+    Matrix matrix;
+    matrix.Translate(SelfTestRandom(state) * 10.0f, SelfTestRandom(state) * 10.0f, SelfTestRandom(state));
+    matrix.Roll(SelfTestRandom(state) * 3.14159265f);
+    matrix.Scale(2.5f + SelfTestRandom(state) * 2.0f, 2.5f + SelfTestRandom(state) * 2.0f, 1.0f);
+    matrix.Translate(SelfTestRandom(state), SelfTestRandom(state), 0.0f);
+    return matrix;
+}
+
+// a * b in double, rounded once at the end
+static Matrix MultiplyReference(const Matrix &a, const Matrix &b) {
+    Matrix r;
+    for(int i = 0; i < 4; i++) {
+        for(int j = 0; j < 4; j++) {
+            double sum = 0.0;
+            for(int k = 0; k < 4; k++) {
+                sum += (double)a.m[i][k] * (double)b.m[k][j];
+            }
+            r.m[i][j] = (float)sum;
+        }
+    }
+    return r;
+}
+
+bool RunMatrixSelfTests() {
+    unsigned int state = 0x9e3779b9;
+    
+    // the edge cases, then random ones of ordinary size
+    std::vector<Matrix> matrices;
+    matrices.push_back(Matrix());
+    matrices.push_back(Matrix::Translation(3.5f, -2.25f, 0.75f));
+    matrices.push_back(Matrix::Translation(-1000.0f, 0.001f, 0.0f));
+    matrices.push_back(Matrix::Scaling(1.0e-3f, 4096.0f, 1.0f));
+    matrices.push_back(Matrix::OrthoProjection(-5.33f, 5.33f, -3.0f, 3.0f, -1.0f, 1.0f));
+    matrices.push_back(Matrix::PerspectiveProjection(1.0f, 16.0f / 9.0f, 0.1f, 100.0f));
+    matrices.push_back(RandomMatrix(state, 1.0e15f));
+    matrices.push_back(RandomMatrix(state, 1.0e-15f));
+    Matrix rolled;
+    rolled.Translate(0.5f, -0.25f, 0.0f);
+    rolled.Roll(0.3f);
+    rolled.Scale(2.0f, 0.5f, 1.0f);
+    matrices.push_back(rolled);
+    for(int i = 0; i < 200; i++) {
+        matrices.push_back(RandomMatrix(state, 10.0f));
+    }
+    
+    std::vector<const char *> names;
+    std::vector<Matrix::MultiplyFunction> kernels;
+#ifdef MATRIX_X86
+    if(Matrix::HasSSE()) {
+        names.push_back("Matrix::MultiplySSE vs MultiplyScalar");
+        kernels.push_back(Matrix::MultiplySSE);
+    }
+    if(Matrix::HasAVX()) {
+        names.push_back("Matrix::MultiplyAVX vs MultiplyScalar");
+        kernels.push_back(Matrix::MultiplyAVX);
+    }
+#endif
+    
+    // scalar against double first, so the kernels are held to a baseline that's right itself
+    MatrixCheck scalarCheck = MakeCheck("Matrix::MultiplyScalar vs double", 4);
+    std::vector<MatrixCheck> kernelChecks;
+    for(size_t k = 0; k < kernels.size(); k++) {
+        kernelChecks.push_back(MakeCheck(names[k], 4));
+    }
+    for(size_t i = 0; i < matrices.size(); i++) {
+        for(size_t j = 0; j < matrices.size(); j++) {
+            const Matrix &a = matrices[i];
+            const Matrix &b = matrices[j];
+            Matrix scale = ProductScale(a, b);
+            Matrix expected;
+            Matrix::MultiplyScalar(a, b, expected);
+            Check(scalarCheck, expected, MultiplyReference(a, b), scale);
+            for(size_t k = 0; k < kernels.size(); k++) {
+                Matrix result;
+                kernels[k](a, b, result);
+                Check(kernelChecks[k], result, expected, scale);
+            }
+        }
+    }
+    
+    // general inverses go through InverseSSE when there is SSE, affine ones through InverseAffine
+    MatrixCheck generalCheck = MakeCheck("Matrix::Inverse (general) vs InverseScalar", 64);
+#ifdef MATRIX_X86
+    MatrixCheck sseCheck = MakeCheck("Matrix::InverseSSE vs InverseScalar", 64);
+#endif
+    MatrixCheck affineCheck = MakeCheck("Matrix::Inverse (affine) vs InverseScalar", 64);
+    MatrixCheck identityCheck = MakeCheck("M * M.Inverse() vs identity", 64);
+    MatrixCheck projectiveCheck = MakeCheck("Matrix::Inverse (projective)", 64);
+    for(int i = 0; i < 1000; i++) {
+        Matrix general = RandomInvertible(state);
+        Matrix expected = general.InverseScalar();
+        Matrix scale = LargestScale(expected);
+        CheckThat(generalCheck, !general.IsAffine(), "random matrix taken for affine");
+        Check(generalCheck, general.Inverse(), expected, scale);
+#ifdef MATRIX_X86
+        if(Matrix::HasSSE()) {
+            Check(sseCheck, general.InverseSSE(), expected, scale);
+        }
+#endif
+        Matrix inverse = general.Inverse();
+        Check(identityCheck, general * inverse, Matrix(), ProductScale(general, inverse));
+        
+        Matrix affine = RandomAffine(state);
+        expected = affine.InverseScalar();
+        CheckThat(affineCheck, affine.IsAffine(), "Translate/Roll/Scale composition not taken for affine");
+        inverse = affine.Inverse();
+        Check(affineCheck, inverse, expected, LargestScale(expected));
+        Check(identityCheck, affine * inverse, Matrix(), ProductScale(affine, inverse));
+    }
+    
+    // a projective row has to keep Inverse off the affine shortcut, which would ignore it
+    std::vector<Matrix> projective;
+    projective.push_back(Matrix::PerspectiveProjection(1.0f, 16.0f / 9.0f, 0.1f, 100.0f));
+    projective.push_back(Matrix::PerspectiveProjection(0.5f, 1.0f, 1.0f, 1000.0f));
+    for(int i = 0; i < 3; i++) {
+        Matrix almostAffine = RandomAffine(state);
+        almostAffine.m[i][3] = 0.01f;
+        projective.push_back(almostAffine);
+    }
+    Matrix weighted = RandomAffine(state);
+    weighted.m[3][3] = 2.0f;
+    projective.push_back(weighted);
+    for(size_t i = 0; i < projective.size(); i++) {
+        const Matrix &matrix = projective[i];
+        Matrix expected = matrix.InverseScalar();
+        Matrix inverse = matrix.Inverse();
+        CheckThat(projectiveCheck, !matrix.IsAffine(), "projective matrix taken for affine");
+        Check(projectiveCheck, inverse, expected, LargestScale(expected));
+        Check(identityCheck, matrix * inverse, Matrix(), ProductScale(matrix, inverse));
+    }
+    
+    bool passed = Report(scalarCheck);
+    for(size_t k = 0; k < kernelChecks.size(); k++) {
+        passed = Report(kernelChecks[k]) && passed;
+    }
+    passed = Report(generalCheck) && passed;
+#ifdef MATRIX_X86
+    if(Matrix::HasSSE()) {
+        passed = Report(sseCheck) && passed;
+    }
+#endif
+    passed = Report(affineCheck) && passed;
+    passed = Report(projectiveCheck) && passed;
+    passed = Report(identityCheck) && passed;
+    printf("matrix self test %s\n", passed ? "passed" : "FAILED");
+    return passed;
+}
+
+void RunShaderProgramBenchmarks(Benchmark &benchmark, ShaderProgram &program) {
+    // alternate between two values so each call really has something to upload
+    Matrix matrices[2];
+    matrices[1].Translate(1.0f, 0.0f, 0.0f);
+    int frame = 0;
+    
+    benchmark.Run("ShaderProgram::SetModelMatrix", [&]() {
+        program.SetModelMatrix(matrices[frame++ & 1]);
+    });
+    benchmark.Run("ShaderProgram::SetModelMatrix (unchanged)", [&]() {
+        program.SetModelMatrix(matrices[0]);
+    });
+    benchmark.Run("ShaderProgram::SetViewMatrix", [&]() {
+        program.SetViewMatrix(matrices[frame++ & 1]);
+    });
+    benchmark.Run("ShaderProgram::SetProjectionMatrix", [&]() {
+        program.SetProjectionMatrix(matrices[frame++ & 1]);
+    });
+    benchmark.Run("ShaderProgram::SetCamera", [&]() {
+        ShaderProgram::SetCamera(matrices[frame & 1], matrices[(frame + 1) & 1]);
+        frame++;
+    });
+    benchmark.Run("ShaderProgram::SetColor", [&]() {
+        float value = (float)(frame++ & 1);
+        program.SetColor(value, value, value, 1.0f);
+    });
+}
+
+void RunImageDecodeBenchmarks(Benchmark &benchmark, const std::vector<std::string> &imageFiles) {
+    for(size_t i = 0; i < imageFiles.size(); i++) {
+        // decode from memory so the file read isn't part of the timing
+        std::ifstream infile(imageFiles[i], std::ios::binary);
+        std::vector<unsigned char> file((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+        int w, h, comp;
+        if(file.empty() || !stbi_info_from_memory(file.data(), (int)file.size(), &w, &h, &comp)) {
+            printf("Unable to read %s for the decode benchmark\n", imageFiles[i].c_str());
+            continue;
+        }
+        
+        // items are pixels, so items/sec is decode throughput
+        for(int simd = 0; simd <= 1; simd++) {
+            stbi_set_png_simd(simd);
+            benchmark.Run("stbi_load " + imageFiles[i] + (simd ? " (simd)" : " (scalar)"), [&]() {
+                unsigned char *image = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &comp, STBI_rgb_alpha);
+                benchmark.sink = image[0];
+                stbi_image_free(image);
+            }, w * h);
+        }
+    }
+    stbi_set_png_simd(1);
+}
+
+void RunSpriteBenchmarks(Benchmark &benchmark, ShaderProgram &program, GLuint texture, int spriteCount, ShaderProgram *instancedProgram, VertexRing *ring) {
+    // a grid filling the default camera, rotated a little so the batch has real transforms to apply
+    std::vector<Transform2D> transforms(spriteCount);
+    int columns = (int)sqrtf((float)spriteCount) + 1;
+    for(int i = 0; i < spriteCount; i++) {
+        transforms[i].SetRoll(i * 0.01f);
+        transforms[i].SetPosition(-5.0f + 10.0f * (i % columns) / columns, -2.8f + 5.6f * (i / columns) / columns);
+    }
+    float size = 0.05f;
+    GLfloat texCoords[] = { 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+    GLfloat vertices[] = { -size, -size, size, size, -size, size, size, size, -size, -size, size, -size };
+    std::string count = std::to_string(spriteCount);
+    
+    program.Use();
+    // attributes enabled and disabled around every draw, then the same through the program's layout
+    VertexLayout::BindNone();
+    benchmark.Run("sprites per draw x" + count, [&]() {
+        for(int i = 0; i < spriteCount; i++) {
+            program.SetModelMatrix(transforms[i]);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, vertices);
+            glEnableVertexAttribArray(program.positionAttribute);
+            glVertexAttribPointer(program.texCoordAttribute, 2, GL_FLOAT, false, 0, texCoords);
+            glEnableVertexAttribArray(program.texCoordAttribute);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glDisableVertexAttribArray(program.positionAttribute);
+            glDisableVertexAttribArray(program.texCoordAttribute);
+        }
+        glFinish();
+    }, spriteCount);
+#ifdef _WINDOWS
+    // the quad never changes, so in a buffer the layout only has to point at it once
+    GLuint quadBuffer;
+    glGenBuffers(1, &quadBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices) + sizeof(texCoords), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(vertices), sizeof(texCoords), texCoords);
+    benchmark.Run("sprites per draw layout x" + count, [&]() {
+        for(int i = 0; i < spriteCount; i++) {
+            program.SetModelMatrix(transforms[i]);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            if(!program.layout.Bind()) {
+                program.layout.Pointer(0, (const void *)0);
+                program.layout.Pointer(1, (const void *)sizeof(vertices));
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            program.layout.Unbind();
+        }
+        glFinish();
+    }, spriteCount);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(1, &quadBuffer);
+    // the next draw has to point the attributes again, not at the deleted buffer
+    program.layout.Cleanup();
+#endif
+    
+    // once from client arrays, then streamed through the ring
+    for(int streamed = 0; streamed <= (ring != NULL ? 1 : 0); streamed++) {
+        VertexRing *batchRing = streamed ? ring : NULL;
+        std::string mode = streamed ? " ring x" : " x";
+        
+        // float positions and texCoords, then packed
+        for(int packed = 0; packed <= 1; packed++) {
+            SpriteBatch batch;
+            batch.ring = batchRing;
+            batch.packed = packed != 0;
+            unsigned long long streamedBefore = batchRing ? batchRing->bytesStreamed : 0;
+            benchmark.Run(std::string(packed ? "sprites SpriteBatch packed" : "sprites SpriteBatch") + mode + count, [&]() {
+                batch.Begin(&program);
+                for(int i = 0; i < spriteCount; i++) {
+                    batch.Draw(texture, transforms[i], -size, -size, size, size, 0.0f, 0.0f, 1.0f, 1.0f);
+                }
+                batch.End();
+                if(batchRing) {
+                    batchRing->EndFrame();
+                }
+                glFinish();
+            }, spriteCount);
+            if(batchRing) {
+                benchmark.results.back().bytesPerOp = (double)(batchRing->bytesStreamed - streamedBefore) / (benchmark.warmupIterations + benchmark.iterations);
+            }
+        }
+        
+        if(instancedProgram != NULL) {
+            // the same quads, as a position, size and rotation per sprite
+            std::vector<float> rotations(spriteCount);
+            for(int i = 0; i < spriteCount; i++) {
+                rotations[i] = i * 0.01f;
+            }
+            InstancedSpriteBatch instancedBatch;
+            instancedBatch.ring = batchRing;
+            unsigned long long streamedBefore = batchRing ? batchRing->bytesStreamed : 0;
+            benchmark.Run("sprites instanced" + mode + count, [&]() {
+                instancedBatch.Begin(instancedProgram);
+                for(int i = 0; i < spriteCount; i++) {
+                    instancedBatch.Draw(texture, transforms[i].tx, transforms[i].ty, size * 2.0f, size * 2.0f, rotations[i], 0.0f, 0.0f, 1.0f, 1.0f);
+                }
+                instancedBatch.End();
+                if(batchRing) {
+                    batchRing->EndFrame();
+                }
+                glFinish();
+            }, spriteCount);
+            if(batchRing) {
+                benchmark.results.back().bytesPerOp = (double)(batchRing->bytesStreamed - streamedBefore) / (benchmark.warmupIterations + benchmark.iterations);
+            }
+            instancedBatch.Cleanup();
+            program.Use();
+        }
+    }
+}
+
+void RunRenderQueueBenchmarks(Benchmark &benchmark, ShaderProgram &program, GLuint firstTexture, GLuint secondTexture, int spriteCount) {
+    std::vector<Transform2D> transforms(spriteCount);
+    int columns = (int)sqrtf((float)spriteCount) + 1;
+    for(int i = 0; i < spriteCount; i++) {
+        transforms[i].SetPosition(-5.0f + 10.0f * (i % columns) / columns, -2.8f + 5.6f * (i / columns) / columns);
+    }
+    float size = 0.05f;
+    std::string count = std::to_string(spriteCount);
+    
+    SpriteBatch batch;
+    benchmark.Run("sprites unsorted SpriteBatch x" + count, [&]() {
+        batch.Begin(&program);
+        for(int i = 0; i < spriteCount; i++) {
+            batch.Draw(i % 2 ? secondTexture : firstTexture, transforms[i], -size, -size, size, size, 0.0f, 0.0f, 1.0f, 1.0f);
+        }
+        batch.End();
+        glFinish();
+    }, spriteCount);
+    
+    RenderQueue queue;
+    RenderCommand command;
+    command.program = &program;
+    command.blend = RENDER_BLEND_ALPHA;
+    command.left = -size;
+    command.bottom = -size;
+    command.right = size;
+    command.top = size;
+    command.u0 = 0.0f;
+    command.v0 = 0.0f;
+    command.u1 = 1.0f;
+    command.v1 = 1.0f;
+    benchmark.Run("sprites RenderQueue x" + count, [&]() {
+        for(int i = 0; i < spriteCount; i++) {
+            command.texture = i % 2 ? secondTexture : firstTexture;
+            command.transform = transforms[i];
+            queue.Add(command, 0);
+        }
+        queue.Submit();
+        glFinish();
+    }, spriteCount);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <vector>
+#include "ShaderProgram.h"
+#include "Transform2D.h"
+#include "VertexRing.h"
+#include "PackedVertex.h"
+
+// collects textured quads with their transforms already applied on the CPU, so a frame of sprites
+// goes to GL as one indexed draw per texture instead of a model matrix upload and a draw per sprite.
+// The batch flushes when the texture changes, when it holds as many quads as the shared index buffer
+// covers, and at End. Sprites sharing a sheet should be drawn together, every texture switch costs a draw
+class SpriteBatch {
+    public:
+
+        SpriteBatch();
+
+        // starts a batch drawn with this program, the model matrix is set to identity while it draws,
+        // or to 1 / positionScale when packed
+        void Begin(ShaderProgram *program);
+        // quad from (left, bottom) to (right, top) in sprite space, placed by transform. u0 v0 is the
+        // top left of the region on the sheet, u1 v1 the bottom right
+        void Draw(GLuint texture, const Transform2D &transform, float left, float bottom, float right, float top, float u0, float v0, float u1, float v1);
+        // prebuilt quads in sprite space, like a line of text. 4 vertices a quad in QuadIndexBuffer order,
+        // 2 floats per vertex in both arrays
+        void Draw(GLuint texture, const Transform2D &transform, const float *vertices, const float *texCoords, int quadCount);
+        // draws what has been collected so far
+        void Flush();
+        void End();
+
+        ShaderProgram *program;
+        GLuint texture;
+        std::vector<float> vertices;
+        std::vector<float> texCoords;
+        // flushes stream through this when it's set, else they draw from the vectors
+        VertexRing *ring;
+        // flushes go to GL as PackedVertex, half the bytes. sprites have to stay within
+        // 32767 / positionScale units of the origin and their texCoords within 0..1
+        bool packed;
+        float positionScale;
+        std::vector<PackedVertex> packedVertices;
+
+        // since the last Begin
+        int sprites;
+        int drawCalls;
+};
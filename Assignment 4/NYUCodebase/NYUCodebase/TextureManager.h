@@ -0,0 +1,49 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <string>
+#include <map>
+
+// textures shared by file path. Acquire the same file twice and you get the same texture with
+// two references. Released textures stay cached so a level that comes back doesn't reload them,
+// until the GPU bytes go over the budget, then the least recently used unreferenced ones go.
+// Referenced textures are never evicted, the budget can be exceeded while they are all in use
+class TextureManager {
+    public:
+
+        TextureManager(size_t budgetBytes = 256 * 1024 * 1024);
+
+        // loads on first use, 0 if the image can't be read
+        GLuint Acquire(const std::string &filePath);
+        void Release(GLuint texture);
+        // marks the texture used this frame for the LRU order
+        void Touch(GLuint texture);
+
+        void SetBudget(size_t budgetBytes);
+        // deletes unreferenced textures, oldest first, until the total fits the budget
+        void Evict();
+        // deletes every texture, referenced or not
+        void Cleanup();
+
+        struct Entry {
+            GLuint texture;
+            int width, height;
+            size_t bytes;
+            int references;
+            unsigned long long lastUsed;
+        };
+
+        std::map<std::string, Entry> entries;
+        std::map<GLuint, std::string> paths;
+        size_t budgetBytes;
+        size_t gpuBytes;
+        // bumped on every Acquire/Touch, stands in for time in the LRU order
+        unsigned long long useClock;
+
+        int hits;
+        int misses;
+        int evictions;
+};
@@ -0,0 +1,113 @@
+
+#include "Transform2D.h"
+#include <math.h>
+
+Transform2D::Transform2D() {
+    Identity();
+}
+
+Transform2D::Transform2D(float a, float b, float c, float d, float tx, float ty) : a(a), b(b), c(c), d(d), tx(tx), ty(ty) {}
+
+void Transform2D::Identity() {
+    a = 1.0f;
+    b = 0.0f;
+    c = 0.0f;
+    d = 1.0f;
+    tx = 0.0f;
+    ty = 0.0f;
+}
+
+Transform2D Transform2D::operator * (const Transform2D &t2) const {
+    Transform2D r;
+    r.a = t2.a * a + t2.c * b;
+    r.b = t2.b * a + t2.d * b;
+    r.c = t2.a * c + t2.c * d;
+    r.d = t2.b * c + t2.d * d;
+    r.tx = t2.a * tx + t2.c * ty + t2.tx;
+    r.ty = t2.b * tx + t2.d * ty + t2.ty;
+    return r;
+}
+
+Transform2D Transform2D::Inverse() const {
+    float invDet = 1.0f / (a * d - b * c);
+    Transform2D r;
+    r.a = d * invDet;
+    r.b = -b * invDet;
+    r.c = -c * invDet;
+    r.d = a * invDet;
+    r.tx = -(r.a * tx + r.c * ty);
+    r.ty = -(r.b * tx + r.d * ty);
+    return r;
+}
+
+void Transform2D::Translate(float x, float y) {
+    tx += a * x + c * y;
+    ty += b * x + d * y;
+}
+
+void Transform2D::Scale(float x, float y) {
+    a *= x;
+    b *= x;
+    c *= y;
+    d *= y;
+}
+
+void Transform2D::Rotate(float rotation) {
+    Roll(rotation);
+}
+
+void Transform2D::Roll(float roll) {
+    float sine, cosine;
+    Matrix::SinCos(roll, sine, cosine);
+    float newA = a * cosine + c * sine;
+    float newB = b * cosine + d * sine;
+    c = c * cosine - a * sine;
+    d = d * cosine - b * sine;
+    a = newA;
+    b = newB;
+}
+
+void Transform2D::SetPosition(float x, float y) {
+    tx = x;
+    ty = y;
+}
+
+void Transform2D::SetScale(float x, float y) {
+    a = x;
+    d = y;
+}
+
+void Transform2D::SetRotation(float rotation) {
+    SetRoll(rotation);
+}
+
+void Transform2D::SetRoll(float roll) {
+    float sine, cosine;
+    Matrix::SinCos(roll, sine, cosine);
+    a = cosine;
+    c = -sine;
+    b = sine;
+    d = cosine;
+}
+
+void Transform2D::TransformPoint(float &x, float &y) const {
+    float newX = a * x + c * y + tx;
+    y = b * x + d * y + ty;
+    x = newX;
+}
+
+void Transform2D::ToMatrix(Matrix &matrix) const {
+    matrix.Identity();
+    matrix.m[0][0] = a;
+    matrix.m[0][1] = b;
+    matrix.m[1][0] = c;
+    matrix.m[1][1] = d;
+    matrix.m[3][0] = tx;
+    matrix.m[3][1] = ty;
+}
+
+Matrix Transform2D::ToMatrix() const {
+    Matrix matrix;
+    ToMatrix(matrix);
+    return matrix;
+}
@@ -7,6 +7,13 @@
 #include <SDL_opengl.h>
 #include <SDL_image.h>
 #include "ShaderProgram.h"
+#include "TextureManager.h"
+#include "CookedTexture.h"
+#include "TextureLoader.h"
+#include "VertexRing.h"
+#include "QuadIndexBuffer.h"
+#include "PackedVertex.h"
+#include "CameraRect.h"
 //#include "SheetSprite.h"
 #include "Matrix.h"
 #include "stb_image.h"
@@ -15,6 +22,7 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <algorithm>
 #include <vector>
 
 //60 FPS (1 / 60) (update sixty times a second)
@@ -57,23 +65,36 @@ unsigned int levelData[LEVEL_HEIGHT][LEVEL_WIDTH] =
 	{ 152,   0,   8,   0,   8,   0,   8,   0,   8,   0,   8,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152 }
 };
 
+//Tiles in the level, to report how many culling left out
+int CountLevelTiles() {
+	int tiles = 0;
+	for (int y = 0; y < LEVEL_HEIGHT; y++) {
+		for (int x = 0; x < LEVEL_WIDTH; x++) {
+			if (levelData[y][x] != 0) {
+				tiles++;
+			}
+		}
+	}
+	return tiles;
+}
+int levelTiles = CountLevelTiles();
+
 SDL_Window* displayWindow;
 
+//Textures loaded up front go through the manager, so loading the same file twice shares one texture.
+//The sprite sheet comes from the TextureLoader instead, which deletes it in its own Cleanup
+TextureManager textureManager;
+
+//Every frame's vertices are streamed through this instead of being copied out of client arrays by the driver
+VertexRing vertexRing;
+//What the camera sees this frame, set by Render, the map and sprites outside it aren't drawn
+CameraRect cameraRect;
+
 //Function to load texture as unsigned int
 GLuint LoadTexture(const char *filePath) {
-	int w, h, comp;
-	unsigned char* image = stbi_load(filePath, &w, &h, &comp, STBI_rgb_alpha);
-	if (image == NULL) {
-		std::cout << "Unable to load image. Make sure the path is correct\n";
-		assert(false);
-	}
-	GLuint retTexture;
-	glGenTextures(1, &retTexture);
-	glBindTexture(GL_TEXTURE_2D, retTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	stbi_image_free(image);
+	GLuint retTexture = textureManager.Acquire(filePath);
+	//Acquire already printed which file failed
+	assert(retTexture != 0);
 	return retTexture;
 }
 
@@ -102,30 +123,26 @@ void SheetSprite::Draw(ShaderProgram* program) const {
 		float spriteWidth = 1.0 / (float)spriteCountX;
 		float spriteHeight = 1.0 / (float)spriteCountY;
 
+		//Corners in the shared index buffer's order: bottom left, top right, top left, bottom right
 		float texCoords[] = {
 			u, v + spriteHeight,
 			u + spriteWidth, v,
 			u, v,
-			u + spriteWidth, v,
-			u, v + spriteHeight,
 			u + spriteWidth, v + spriteHeight
 		};
 		float vertices[] = {
 			-0.5f*size, -0.5f*size,
 			0.5f*size, 0.5f*size,
 			-0.5f*size, 0.5f*size,
-			0.5f*size, 0.5f*size,
-			-0.5f*size,-0.5f*size,
 			0.5f*size, -0.5f*size };
 
 		// draw this data
-		glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertices);
-		glEnableVertexAttribArray(program->positionAttribute);
-		glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoords);
-		glEnableVertexAttribArray(program->texCoordAttribute);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program->positionAttribute);
-		glDisableVertexAttribArray(program->texCoordAttribute);
+		program->layout.Bind(!vertexRing.Reserve(sizeof(vertices) + sizeof(texCoords), 2));
+		program->layout.Pointer(0, vertexRing.Stream(vertices, sizeof(vertices)));
+		program->layout.Pointer(1, vertexRing.Stream(texCoords, sizeof(texCoords)));
+		QuadIndexBuffer::Shared().Draw(1, 4 * sizeof(float));
+		program->layout.Unbind();
+		vertexRing.Unbind();
 	}
 
 }
@@ -141,31 +158,37 @@ public:
 	float z;
 };
 
+//The map is drawn in tile space, a unit a tile, so its corners are whole numbers and pack into shorts.
+//Draw it with TILE_SIZE in the model matrix
 void DrawMap(ShaderProgram *program, int texture) {
-	std::vector<float> vertexData;
-	std::vector<float> texCoordData;
-	for (int y = 0; y < LEVEL_HEIGHT; y++) {
-		for (int x = 0; x < LEVEL_WIDTH; x++) {
+	//Only the tiles under the camera are looked at, column x covers TILE_SIZE * x to TILE_SIZE * (x + 1)
+	//and row y covers -TILE_SIZE * (y + 1) to -TILE_SIZE * y
+	int firstX = std::max(0, (int)floorf(cameraRect.left / TILE_SIZE));
+	int lastX = std::min(LEVEL_WIDTH - 1, (int)floorf(cameraRect.right / TILE_SIZE));
+	int firstY = std::max(0, (int)floorf(-cameraRect.top / TILE_SIZE));
+	int lastY = std::min(LEVEL_HEIGHT - 1, (int)floorf(-cameraRect.bottom / TILE_SIZE));
+	std::vector<PackedVertex> vertexData;
+	for (int y = firstY; y <= lastY; y++) {
+		for (int x = firstX; x <= lastX; x++) {
 			if (levelData[y][x] != 0) {
 				float u = (float)(((int)levelData[y][x]) % SPRITE_COUNT_X) / (float)SPRITE_COUNT_X;
 				float v = (float)(((int)levelData[y][x]) / SPRITE_COUNT_X) / (float)SPRITE_COUNT_Y;
 				float spriteWidth = 1.0f / (float)SPRITE_COUNT_X;
 				float spriteHeight = 1.0f / (float)SPRITE_COUNT_Y;
+				short left = x;
+				short right = x + 1;
+				short top = -y;
+				short bottom = -y - 1;
+				unsigned short u0 = PackTexCoord(u);
+				unsigned short v0 = PackTexCoord(v);
+				unsigned short u1 = PackTexCoord(u + spriteWidth);
+				unsigned short v1 = PackTexCoord(v + spriteHeight);
+				//Bottom left, top right, top left, bottom right, the index buffer makes the triangles
 				vertexData.insert(vertexData.end(), {
-					TILE_SIZE * x, -TILE_SIZE * y,
-					TILE_SIZE * x, (-TILE_SIZE * y) - TILE_SIZE,
-					(TILE_SIZE * x) + TILE_SIZE, (-TILE_SIZE * y) - TILE_SIZE,
-					TILE_SIZE * x, -TILE_SIZE * y,
-					(TILE_SIZE * x) + TILE_SIZE, (-TILE_SIZE * y) - TILE_SIZE,
-					(TILE_SIZE * x) + TILE_SIZE, -TILE_SIZE * y
-					});
-				texCoordData.insert(texCoordData.end(), {
-					u, v,
-					u, v + (spriteHeight),
-					u + spriteWidth, v + (spriteHeight),
-					u, v,
-					u + spriteWidth, v + (spriteHeight),
-					u + spriteWidth, v
+					{ left, bottom, u0, v1 },
+					{ right, top, u1, v0 },
+					{ left, top, u0, v0 },
+					{ right, bottom, u1, v1 }
 					});
 			}
 		}
@@ -175,16 +198,21 @@ void DrawMap(ShaderProgram *program, int texture) {
 	//glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	
 
-	//Draw this data 
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertexData.data());
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoordData.data());
-	glEnableVertexAttribArray(program->texCoordAttribute);
+	int tilesDrawn = (int)(vertexData.size() / 4);
+	cameraRect.drawn += tilesDrawn;
+	cameraRect.culled += levelTiles - tilesDrawn;
 
-	glDrawArrays(GL_TRIANGLES, 0, vertexData.size() / 2);
+	//Draw this data, position and texCoord interleaved
+	size_t bytes = vertexData.size() * sizeof(PackedVertex);
+	program->packedLayout.Bind(!vertexRing.Reserve(bytes));
+	const char *base = (const char *)vertexRing.Stream(vertexData.data(), bytes);
+	program->packedLayout.Pointer(0, base + offsetof(PackedVertex, x));
+	program->packedLayout.Pointer(1, base + offsetof(PackedVertex, u));
 
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
+	QuadIndexBuffer::Shared().Draw(vertexData.size() / 4, sizeof(PackedVertex));
+
+	program->packedLayout.Unbind();
+	vertexRing.Unbind();
 
 }
 
@@ -196,21 +224,18 @@ void DrawText(ShaderProgram *program, int fontTexture, std::string text, float s
 		int spriteIndex = (int)text[i];
 		float texture_x = (float)(spriteIndex % 16) / 16.0f;
 		float texture_y = (float)(spriteIndex / 16) / 16.0f;
+		//Bottom left, top right, top left, bottom right, the index buffer makes the triangles
 		vertexData.insert(vertexData.end(), {
-			((size + spacing) * i) + (-0.5f * size), 0.5f * size,
 			((size + spacing) * i) + (-0.5f * size), -0.5f * size,
 			((size + spacing) * i) + (0.5f * size), 0.5f * size,
+			((size + spacing) * i) + (-0.5f * size), 0.5f * size,
 			((size + spacing) * i) + (0.5f * size), -0.5f * size,
-			((size + spacing) * i) + (0.5f * size), 0.5f * size,
-			((size + spacing) * i) + (-0.5f * size), -0.5f * size,
 			});
 		texCoordData.insert(texCoordData.end(), {
-			texture_x, texture_y,
 			texture_x, texture_y + texture_size,
 			texture_x + texture_size, texture_y,
+			texture_x, texture_y,
 			texture_x + texture_size, texture_y + texture_size,
-			texture_x + texture_size, texture_y,
-			texture_x, texture_y + texture_size,
 			});
 	}
 	glBindTexture(GL_TEXTURE_2D, fontTexture);
@@ -218,15 +243,14 @@ void DrawText(ShaderProgram *program, int fontTexture, std::string text, float s
 	glEnable(GL_BLEND);
 
 	// draw this data (use the .data() method of std::vector to get pointer to data)
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertexData.data());
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoordData.data());
-	glEnableVertexAttribArray(program->texCoordAttribute);
+	program->layout.Bind(!vertexRing.Reserve(2 * vertexData.size() * sizeof(float), 2));
+	program->layout.Pointer(0, vertexRing.Stream(vertexData.data(), vertexData.size() * sizeof(float)));
+	program->layout.Pointer(1, vertexRing.Stream(texCoordData.data(), texCoordData.size() * sizeof(float)));
 
-	glDrawArrays(GL_TRIANGLES, 0, 6 * text.size());
+	QuadIndexBuffer::Shared().Draw(text.size(), 4 * sizeof(float));
 
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
+	program->layout.Unbind();
+	vertexRing.Unbind();
 
 }
 
@@ -524,19 +548,46 @@ void Update(float elapsed) {
 }
 
 
+//Shown while the sprite sheet is still loading
+void RenderMenu(ShaderProgram *program) {
+	Matrix menuViewMatrix;
+	program->SetViewMatrix(menuViewMatrix);
+	titleModelMatrix.SetPosition(-1.8, 0.0, 0.0);
+	program->SetModelMatrix(titleModelMatrix);
+	DrawText(program, textTex, "Loading...", 0.4, 0.0);
+}
+
 void Render(ShaderProgram *program) {
-	playerModelMatrix.SetPosition(state.player.position.x, state.player.position.y, 0.0);
-	program->SetModelMatrix(playerModelMatrix);
-	state.player.Draw(program);
+	switch (mode) {
+	case STATE_MAIN_MENU:
+		RenderMenu(program);
+		break;
+	case STATE_GAME_LEVEL:
+		cameraRect.Set(viewMatrix, projectionMatrix);
+		if (cameraRect.Visible(state.player.position.x, state.player.position.y, 0.5f * state.player.sprite.size, 0.5f * state.player.sprite.size)) {
+			playerModelMatrix.SetPosition(state.player.position.x, state.player.position.y, 0.0);
+			program->SetModelMatrix(playerModelMatrix);
+			state.player.Draw(program);
+		}
 
-	tileModelMatrix.SetPosition(0.0, 0.0, 0.0);
-	program->SetModelMatrix(tileModelMatrix);
-	DrawMap(program, tileTexture);
+		//The map is in tile space
+		tileModelMatrix = Matrix::Scaling(TILE_SIZE, TILE_SIZE, 1.0f);
+		program->SetModelMatrix(tileModelMatrix);
+		DrawMap(program, tileTexture);
+		break;
+	}
 
 }
 
 int main(int argc, char *argv[])
 {
+	//Cook the textures into .ctex files with mip chains and exit, the game loads those instead of the PNGs when they exist
+	if (argc > 1 && std::string(argv[1]) == "--cook-textures") {
+		bool cooked = CookedTexture::Cook("spritesheet_rgba.png", CookedTexture::CookedPath("spritesheet_rgba.png"));
+		cooked = CookedTexture::Cook("font1.png", CookedTexture::CookedPath("font1.png")) && cooked;
+		return cooked ? 0 : 1;
+	}
+
 	SDL_Init(SDL_INIT_VIDEO);
 
 	displayWindow = SDL_CreateWindow("Assignment 4: Platformer", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640 * 2, 360 * 2, SDL_WINDOW_OPENGL);
@@ -553,10 +604,12 @@ int main(int argc, char *argv[])
 	//Load the shader program
 	ShaderProgram program;
 	//WE'RE GONNA WANT THE TEXTURED VERTEX SHADER AND FRAGMENT SHADER
-	program.Load(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
+	program.Submit(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
+	//Compiles in the background, it gets finished the first time the program is used
 
-	//Setting up the Sprite sheet
-	spriteSheetTexture = LoadTexture("spritesheet_rgba.png");
+	//Setting up the Sprite sheet, decoded on worker threads while the menu is up
+	TextureLoader textureLoader;
+	spriteSheetTexture = textureLoader.Load("spritesheet_rgba.png");
 	textTex = LoadTexture("font1.png");
 
 	//playerShip2_red.png (line 224)
@@ -579,6 +632,7 @@ int main(int argc, char *argv[])
 
 	//This is how we will keep track of time
 	float lastFrameTicks = 0.0;
+	float lastTitleTicks = 0.0;
 	float angle = 0.0; 
 	float accumulator = 0.0;
 
@@ -590,7 +644,7 @@ int main(int argc, char *argv[])
 
 	viewMatrix.SetPosition(-5.0, -1.0, 0.0); 
 
-	mode = STATE_GAME_LEVEL;
+	mode = STATE_MAIN_MENU;
 
 	
 
@@ -603,13 +657,21 @@ int main(int argc, char *argv[])
 				done = true;
 			}
 
-			ProcessGamePollingInput(event, spaceDown);
+			if (mode == STATE_GAME_LEVEL) {
+				ProcessGamePollingInput(event, spaceDown);
+			}
 		}
 
 		glClear(GL_COLOR_BUFFER_BIT);
 
+		//Upload whatever the texture workers finished, the level starts once the sprite sheet is in
+		textureLoader.Update();
+		if (mode == STATE_MAIN_MENU && textureLoader.IsReady(spriteSheetTexture)) {
+			mode = STATE_GAME_LEVEL;
+		}
+
 		//Use the specified program ID
-		glUseProgram(program.programID);
+		program.Use();
 
 		//Pass the matrices to our program
 		program.SetModelMatrix(modelMatrix);
@@ -620,7 +682,9 @@ int main(int argc, char *argv[])
 		float elapsed = ticks - lastFrameTicks;
 		lastFrameTicks = ticks;
 
-		ProcessGameInput();
+		if (mode == STATE_GAME_LEVEL) {
+			ProcessGameInput();
+		}
 
 		//Keeping time with a fixed timestep
 		elapsed += accumulator;
@@ -629,7 +693,9 @@ int main(int argc, char *argv[])
 			continue;
 		}
 		while (elapsed >= FIXED_TIMESTEP) {
-			Update(FIXED_TIMESTEP);
+			if (mode == STATE_GAME_LEVEL) {
+				Update(FIXED_TIMESTEP);
+			}
 			elapsed -= FIXED_TIMESTEP;
 		}
 		accumulator = elapsed;
@@ -637,8 +703,26 @@ int main(int argc, char *argv[])
 		Render(&program);
 
 		SDL_GL_SwapWindow(displayWindow);
+		//Next frame writes to the next region of the ring
+		vertexRing.EndFrame();
+
+		//Vertex bytes the indexed quads saved and what culling left out, shown in the title once a second
+		QuadIndexBuffer::Shared().EndFrame();
+		if (ticks - lastTitleTicks >= 1.0f) {
+			lastTitleTicks = ticks;
+			std::string title = "Assignment 4: Platformer - " + std::to_string(QuadIndexBuffer::Shared().lastFrameBytesSaved) + " vertex bytes saved per frame";
+			//The menu doesn't Set the camera rect, the counts are only this frame's during the level
+			if (mode == STATE_GAME_LEVEL) {
+				title += ", " + std::to_string(cameraRect.drawn) + " sprites and tiles drawn, " + std::to_string(cameraRect.culled) + " culled";
+			}
+			SDL_SetWindowTitle(displayWindow, title.c_str());
+		}
 	}
 
+	textureLoader.Cleanup();
+	textureManager.Cleanup();
+	vertexRing.Cleanup();
+	QuadIndexBuffer::Shared().Cleanup();
 	SDL_Quit();
 	return 0;
 }
@@ -0,0 +1,116 @@
+#define STB_IMAGE_IMPLEMENTATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include "ShaderProgram.h"
+#include "TextureManager.h"
+#include "InstancedSpriteBatch.h"
+#include "VertexRing.h"
+#include "QuadIndexBuffer.h"
+#include "Benchmark.h"
+#include "stb_image.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+//The game's benchmark suite on its own, built from the same engine files without the game.
+//Runs from the game's folder (the debugger's working directory is set to it), the shaders and images are read from there:
+//Benchmark.exe [--selftest] [--bench-warmup N] [--bench-iterations N] [--bench-decode-iterations N] [--bench-frame-iterations N] [--bench-sprites N] [--bench-output file.json]
+int main(int argc, char *argv[])
+{
+	bool selfTestOnly = false;
+	long long benchWarmup = 10000;
+	long long benchIterations = 1000000;
+	long long benchDecodeIterations = 50;
+	long long benchFrameIterations = 100;
+	int benchSprites = 10000;
+	const char *benchOutput = "benchmark.json";
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--selftest") {
+			selfTestOnly = true;
+		}
+		else if (arg == "--bench-warmup" && i + 1 < argc) {
+			benchWarmup = atoll(argv[++i]);
+		}
+		else if (arg == "--bench-iterations" && i + 1 < argc) {
+			benchIterations = atoll(argv[++i]);
+		}
+		else if (arg == "--bench-decode-iterations" && i + 1 < argc) {
+			benchDecodeIterations = atoll(argv[++i]);
+		}
+		else if (arg == "--bench-frame-iterations" && i + 1 < argc) {
+			benchFrameIterations = atoll(argv[++i]);
+		}
+		else if (arg == "--bench-sprites" && i + 1 < argc) {
+			benchSprites = atoi(argv[++i]);
+		}
+		else if (arg == "--bench-output" && i + 1 < argc) {
+			benchOutput = argv[++i];
+		}
+	}
+
+	//Kernels that give wrong answers aren't worth timing
+	if (!RunMatrixSelfTests()) {
+		return 1;
+	}
+	if (selfTestOnly) {
+		return 0;
+	}
+
+	//The GL benchmarks need a context, same size as the game's so the sprite frames fill the same pixels
+	SDL_Init(SDL_INIT_VIDEO);
+	SDL_Window *displayWindow = SDL_CreateWindow("Benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640 * 2, 360 * 2, SDL_WINDOW_OPENGL);
+	SDL_GLContext context = SDL_GL_CreateContext(displayWindow);
+	SDL_GL_MakeCurrent(displayWindow, context);
+#ifdef _WINDOWS
+	glewInit();
+#endif
+	glViewport(0, 0, 640 * 2, 360 * 2);
+
+	ShaderProgram program;
+	program.Submit("vertex_textured.glsl", "fragment_textured.glsl");
+	ShaderProgram instancedProgram;
+	if (InstancedSpriteBatch::Supported()) {
+		instancedProgram.Submit("vertex_textured.glsl", "fragment_textured.glsl", INSTANCED_SPRITE_DEFINES);
+	}
+	TextureManager textureManager;
+	VertexRing vertexRing;
+
+	Benchmark benchmark(benchWarmup, benchIterations);
+	RunMatrixBenchmarks(benchmark);
+	RunShaderProgramBenchmarks(benchmark, program);
+	//Decoding is milliseconds a call, it gets its own iteration count and shares the report
+	Benchmark decodeBenchmark(2, benchDecodeIterations);
+	std::vector<std::string> decodeImages;
+	decodeImages.push_back("sheet.png");
+	decodeImages.push_back("pixel_font.png");
+	RunImageDecodeBenchmarks(decodeBenchmark, decodeImages);
+	benchmark.results.insert(benchmark.results.end(), decodeBenchmark.results.begin(), decodeBenchmark.results.end());
+	//Same for whole frames of sprites
+	Benchmark frameBenchmark(5, benchFrameIterations);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLuint sheet = textureManager.Acquire("sheet.png");
+	GLuint font = textureManager.Acquire("pixel_font.png");
+	if (sheet != 0 && font != 0) {
+		RunSpriteBenchmarks(frameBenchmark, program, sheet, benchSprites, InstancedSpriteBatch::Supported() ? &instancedProgram : NULL, &vertexRing);
+		RunRenderQueueBenchmarks(frameBenchmark, program, sheet, font, benchSprites);
+	}
+	benchmark.results.insert(benchmark.results.end(), frameBenchmark.results.begin(), frameBenchmark.results.end());
+	benchmark.PrintResults();
+	bool written = benchmark.WriteJSON(benchOutput);
+
+	textureManager.Cleanup();
+	vertexRing.Cleanup();
+	QuadIndexBuffer::Shared().Cleanup();
+	if (InstancedSpriteBatch::Supported()) {
+		instancedProgram.Cleanup();
+	}
+	program.Cleanup();
+	SDL_Quit();
+	return written ? 0 : 1;
+}
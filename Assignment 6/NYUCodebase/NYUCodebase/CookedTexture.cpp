@@ -0,0 +1,243 @@
+#include "CookedTexture.h"
+#include "stb_image.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// read only view of a whole file, unmapped when it goes out of scope
+class MappedFile {
+    public:
+
+        MappedFile(const std::string &filePath) : data(NULL), size(0) {
+#ifdef _WIN32
+            file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            mapping = NULL;
+            if(file == INVALID_HANDLE_VALUE) {
+                return;
+            }
+            LARGE_INTEGER fileSize;
+            if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+                return;
+            }
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(mapping == NULL) {
+                return;
+            }
+            data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if(data != NULL) {
+                size = (size_t)fileSize.QuadPart;
+            }
+#else
+            int file = open(filePath.c_str(), O_RDONLY);
+            if(file < 0) {
+                return;
+            }
+            struct stat info;
+            if(fstat(file, &info) == 0 && info.st_size > 0) {
+                void *view = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+                if(view != MAP_FAILED) {
+                    data = (const unsigned char *)view;
+                    size = (size_t)info.st_size;
+                }
+            }
+            // the mapping keeps the file alive
+            close(file);
+#endif
+        }
+
+        ~MappedFile() {
+#ifdef _WIN32
+            if(data != NULL) {
+                UnmapViewOfFile(data);
+            }
+            if(mapping != NULL) {
+                CloseHandle(mapping);
+            }
+            if(file != INVALID_HANDLE_VALUE) {
+                CloseHandle(file);
+            }
+#else
+            if(data != NULL) {
+                munmap((void *)data, size);
+            }
+#endif
+        }
+
+        const unsigned char *data;
+        size_t size;
+
+    private:
+        MappedFile(const MappedFile &);
+        MappedFile &operator=(const MappedFile &);
+#ifdef _WIN32
+        HANDLE file;
+        HANDLE mapping;
+#endif
+};
+
+std::string CookedTexture::CookedPath(const std::string &imageFile) {
+    size_t dot = imageFile.find_last_of('.');
+    size_t slash = imageFile.find_last_of("/\\");
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return imageFile + ".ctex";
+    }
+    return imageFile.substr(0, dot) + ".ctex";
+}
+
+bool CookedTexture::Exists(const std::string &cookedFile) {
+    FILE *file = fopen(cookedFile.c_str(), "rb");
+    if(file == NULL) {
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+// halves a level with a 2x2 box filter. colour is weighted by alpha so transparent texels, whatever
+// colour they carry, don't darken the edges of sprites
+static void Downsample(const unsigned char *source, int sourceWidth, int sourceHeight, unsigned char *destination, int width, int height) {
+    for(int y = 0; y < height; y++) {
+        int y0 = y * 2;
+        int y1 = (y * 2 + 1 < sourceHeight) ? y * 2 + 1 : y0;
+        for(int x = 0; x < width; x++) {
+            int x0 = x * 2;
+            int x1 = (x * 2 + 1 < sourceWidth) ? x * 2 + 1 : x0;
+            const unsigned char *texels[4] = {
+                source + (y0 * sourceWidth + x0) * 4,
+                source + (y0 * sourceWidth + x1) * 4,
+                source + (y1 * sourceWidth + x0) * 4,
+                source + (y1 * sourceWidth + x1) * 4
+            };
+            unsigned int alpha = 0;
+            unsigned int colour[3] = { 0, 0, 0 };
+            for(int i = 0; i < 4; i++) {
+                alpha += texels[i][3];
+                for(int c = 0; c < 3; c++) {
+                    colour[c] += texels[i][c] * texels[i][3];
+                }
+            }
+            unsigned char *out = destination + (y * width + x) * 4;
+            for(int c = 0; c < 3; c++) {
+                if(alpha > 0) {
+                    out[c] = (unsigned char)((colour[c] + alpha / 2) / alpha);
+                } else {
+                    out[c] = (unsigned char)((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                }
+            }
+            out[3] = (unsigned char)((alpha + 2) / 4);
+        }
+    }
+}
+
+bool CookedTexture::Cook(const std::string &imageFile, const std::string &cookedFile) {
+    int w, h, comp;
+    unsigned char *image = stbi_load(imageFile.c_str(), &w, &h, &comp, STBI_rgb_alpha);
+    if(image == NULL) {
+        printf("Unable to load image %s for cooking\n", imageFile.c_str());
+        return false;
+    }
+
+    CookedTextureHeader header;
+    header.magic = COOKED_TEXTURE_MAGIC;
+    header.version = COOKED_TEXTURE_VERSION;
+    header.width = w;
+    header.height = h;
+    header.format = COOKED_TEXTURE_RGBA8;
+
+    std::vector<CookedTextureLevel> levels;
+    std::vector<unsigned char> pixels(image, image + w * h * 4);
+    stbi_image_free(image);
+    unsigned int offset = sizeof(CookedTextureHeader);
+    int levelWidth = w;
+    int levelHeight = h;
+    size_t levelStart = 0;
+    while(true) {
+        CookedTextureLevel level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.size = levelWidth * levelHeight * 4;
+        levels.push_back(level);
+        if((levelWidth == 1 && levelHeight == 1) || levels.size() == COOKED_TEXTURE_MAX_LEVELS) {
+            break;
+        }
+        int nextWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+        int nextHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+        size_t nextStart = pixels.size();
+        pixels.resize(nextStart + nextWidth * nextHeight * 4);
+        Downsample(&pixels[levelStart], levelWidth, levelHeight, &pixels[nextStart], nextWidth, nextHeight);
+        levelStart = nextStart;
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+    header.levels = (unsigned int)levels.size();
+    offset += sizeof(CookedTextureLevel) * header.levels;
+    for(size_t i = 0; i < levels.size(); i++) {
+        levels[i].offset = offset;
+        offset += levels[i].size;
+    }
+
+    FILE *file = fopen(cookedFile.c_str(), "wb");
+    if(file == NULL) {
+        printf("Unable to write cooked texture %s\n", cookedFile.c_str());
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(levels.data(), sizeof(CookedTextureLevel), levels.size(), file);
+    fwrite(pixels.data(), 1, pixels.size(), file);
+    fclose(file);
+    printf("Cooked %s: %dx%d, %d mip levels\n", cookedFile.c_str(), w, h, (int)header.levels);
+    return true;
+}
+
+GLuint CookedTexture::Load(const std::string &cookedFile, int *width, int *height, size_t *bytes) {
+    MappedFile file(cookedFile);
+    if(file.data == NULL || file.size < sizeof(CookedTextureHeader)) {
+        return 0;
+    }
+    const CookedTextureHeader *header = (const CookedTextureHeader *)file.data;
+    if(header->magic != COOKED_TEXTURE_MAGIC || header->version != COOKED_TEXTURE_VERSION ||
+       header->format != COOKED_TEXTURE_RGBA8 || header->levels == 0 || header->levels > COOKED_TEXTURE_MAX_LEVELS ||
+       file.size < sizeof(CookedTextureHeader) + sizeof(CookedTextureLevel) * header->levels) {
+        printf("Bad cooked texture %s\n", cookedFile.c_str());
+        return 0;
+    }
+    const CookedTextureLevel *levels = (const CookedTextureLevel *)(file.data + sizeof(CookedTextureHeader));
+    for(unsigned int i = 0; i < header->levels; i++) {
+        if((size_t)levels[i].offset + levels[i].size > file.size || levels[i].size != levels[i].width * levels[i].height * 4) {
+            printf("Truncated cooked texture %s\n", cookedFile.c_str());
+            return 0;
+        }
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    size_t total = 0;
+    for(unsigned int i = 0; i < header->levels; i++) {
+        // straight from the mapping, the pages fault in as the driver copies them
+        glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, file.data + levels[i].offset);
+        total += levels[i].size;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if(width != NULL) {
+        *width = header->width;
+    }
+    if(height != NULL) {
+        *height = header->height;
+    }
+    if(bytes != NULL) {
+        *bytes = total;
+    }
+    return texture;
+}
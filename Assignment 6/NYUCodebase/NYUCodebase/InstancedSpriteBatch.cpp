@@ -0,0 +1,116 @@
+#include "InstancedSpriteBatch.h"
+#include <stddef.h>
+
+InstancedSpriteBatch::InstancedSpriteBatch() : program(NULL), texture(0), ring(NULL), quadBuffer(0), instanceBuffer(0), attributeProgram(0),
+    placementAttribute(-1), rotationAttribute(-1), texRectAttribute(-1), sprites(0), drawCalls(0) {}
+
+void InstancedSpriteBatch::Begin(ShaderProgram *program) {
+    this->program = program;
+    texture = 0;
+    sprites = 0;
+    drawCalls = 0;
+    instances.clear();
+    program->Use();
+    program->SetModelMatrix(Matrix());
+#ifdef _WINDOWS
+    if(quadBuffer == 0) {
+        // a strip of the unit quad, texCoord 0 0 is the top left like the sheets
+        GLfloat quad[] = {
+            -0.5f, -0.5f, 0.0f, 1.0f,
+            0.5f, -0.5f, 1.0f, 1.0f,
+            -0.5f, 0.5f, 0.0f, 0.0f,
+            0.5f, 0.5f, 1.0f, 0.0f
+        };
+        glGenBuffers(1, &quadBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glGenBuffers(1, &instanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    if(attributeProgram != program->programID) {
+        attributeProgram = program->programID;
+        placementAttribute = glGetAttribLocation(attributeProgram, "instancePlacement");
+        rotationAttribute = glGetAttribLocation(attributeProgram, "instanceRotation");
+        texRectAttribute = glGetAttribLocation(attributeProgram, "instanceTexRect");
+        layout.Cleanup();
+        layout = VertexLayout();
+        layout.Add(program->positionAttribute, 2, GL_FLOAT, false, 4 * sizeof(GLfloat));
+        layout.Add(program->texCoordAttribute, 2, GL_FLOAT, false, 4 * sizeof(GLfloat));
+        layout.Add(placementAttribute, 4, GL_FLOAT, false, sizeof(SpriteInstance), 1);
+        layout.Add(rotationAttribute, 1, GL_FLOAT, false, sizeof(SpriteInstance), 1);
+        layout.Add(texRectAttribute, 4, GL_FLOAT, false, sizeof(SpriteInstance), 1);
+    }
+#endif
+}
+
+void InstancedSpriteBatch::Draw(GLuint texture, float x, float y, float width, float height, float rotation, float u0, float v0, float u1, float v1) {
+    if(texture != this->texture) {
+        Flush();
+        this->texture = texture;
+    }
+    SpriteInstance instance = { x, y, width, height, rotation, u0, v0, u1, v1 };
+    instances.push_back(instance);
+    sprites++;
+}
+
+void InstancedSpriteBatch::Flush() {
+    if(instances.empty()) {
+        return;
+    }
+#ifdef _WINDOWS
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    if(!layout.Bind()) {
+        // the quad never moves, with a VAO it stays pointed at it
+        glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+        layout.Pointer(0, (const void *)0);
+        layout.Pointer(1, (const void *)(2 * sizeof(GLfloat)));
+    }
+
+    const char *base = NULL;
+    size_t bytes = instances.size() * sizeof(SpriteInstance);
+    if(ring && ring->Reserve(bytes)) {
+        base = (const char *)ring->Stream(instances.data(), bytes);
+    } else {
+        // orphan last flush's storage instead of waiting for the GPU to finish reading it.
+        // also where a frame too big for the ring goes, the VAO can't read client memory
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes, instances.data(), GL_STREAM_DRAW);
+    }
+    layout.Pointer(2, base + offsetof(SpriteInstance, x));
+    layout.Pointer(3, base + offsetof(SpriteInstance, rotation));
+    layout.Pointer(4, base + offsetof(SpriteInstance, u0));
+
+    glDrawArraysInstancedARB(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)instances.size());
+
+    layout.Unbind();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    drawCalls++;
+#endif
+    instances.clear();
+}
+
+void InstancedSpriteBatch::End() {
+    Flush();
+}
+
+void InstancedSpriteBatch::Cleanup() {
+#ifdef _WINDOWS
+    if(quadBuffer != 0) {
+        glDeleteBuffers(1, &quadBuffer);
+        glDeleteBuffers(1, &instanceBuffer);
+    }
+#endif
+    layout.Cleanup();
+    quadBuffer = 0;
+    instanceBuffer = 0;
+    attributeProgram = 0;
+}
+
+bool InstancedSpriteBatch::Supported() {
+#ifdef _WINDOWS
+    return GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced;
+#else
+    return false;
+#endif
+}
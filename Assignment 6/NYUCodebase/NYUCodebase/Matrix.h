@@ -1,20 +1,42 @@
 
 #pragma once
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define MATRIX_X86
+#endif
+
+// gcc and clang only emit SSE2/AVX instructions inside functions marked for them
+#if defined(MATRIX_X86) && !defined(_MSC_VER)
+    #define MATRIX_TARGET_SSE __attribute__((target("sse2")))
+    #define MATRIX_TARGET_AVX __attribute__((target("avx")))
+#else
+    #define MATRIX_TARGET_SSE
+    #define MATRIX_TARGET_AVX
+#endif
+
 class Matrix {
     public:
     
-        Matrix();
+        constexpr Matrix() : m{{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f}} {}
     
         union {
             float m[4][4];
             float ml[16];
         };
     
-        void Identity();
+        constexpr void Identity();
         Matrix operator * (const Matrix &m2) const;
         Matrix Inverse() const;
     
+        // Inverse() uses the affine path on its own when the bottom row is 0 0 0 1,
+        // call InverseAffine() directly to skip the check for known model and view matrices
+        bool IsAffine() const;
+        Matrix InverseAffine() const;
+        Matrix InverseScalar() const;
+    #ifdef MATRIX_X86
+        Matrix InverseSSE() const;
+    #endif
+    
         void Translate(float x, float y, float z);
         void Scale(float x, float y, float z);
         void Rotate(float rotation);
@@ -22,13 +44,139 @@ class Matrix {
         void Pitch(float pitch);
         void Yaw(float yaw);
     
-        void SetPosition(float x, float y, float z);
-        void SetScale(float x, float y, float z);
+        constexpr void SetPosition(float x, float y, float z);
+        constexpr void SetScale(float x, float y, float z);
         void SetRotation(float rotation);
         void SetRoll(float roll);
         void SetPitch(float pitch);
         void SetYaw(float yaw);
 
-        void SetOrthoProjection(float left, float right, float bottom, float top, float zNear, float zFar);
-        void SetPerspectiveProjection(float fov, float aspect, float zNear, float zFar);
+        constexpr void SetOrthoProjection(float left, float right, float bottom, float top, float zNear, float zFar);
+        constexpr void SetPerspectiveProjection(float fov, float aspect, float zNear, float zFar);
+    
+        // factories for fixed transforms, usable in constexpr so they can be built at compile time:
+        //  constexpr Matrix projectionMatrix = Matrix::OrthoProjection(-5.33f, 5.33f, -3.0f, 3.0f, -1.0f, 1.0f);
+        static constexpr Matrix Translation(float x, float y, float z);
+        static constexpr Matrix Scaling(float x, float y, float z);
+        static constexpr Matrix OrthoProjection(float left, float right, float bottom, float top, float zNear, float zFar);
+        static constexpr Matrix PerspectiveProjection(float fov, float aspect, float zNear, float zFar);
+    
+        // tangent as a continued fraction since tanf can't run at compile time, accurate to float precision for |x| < pi/2
+        static constexpr double Tangent(double x);
+    
+        // transforms 2D points (z = 0, w = 1) in one pass, used to pre-transform sprite quads on the CPU.
+        // the projective row is ignored, so this is only meant for model and view matrices.
+        // src and dst may point to the same array.
+        void TransformPoints(const float *src, float *dst, int count) const;
+        void TransformPoints(const float *srcX, const float *srcY, float *dstX, float *dstY, int count) const;
+    
+        // r = a * b, operator * picks the fastest one the CPU supports the first time it runs
+        typedef void (*MultiplyFunction)(const Matrix &a, const Matrix &b, Matrix &r);
+        static void MultiplyScalar(const Matrix &a, const Matrix &b, Matrix &r);
+    #ifdef MATRIX_X86
+        static void MultiplySSE(const Matrix &a, const Matrix &b, Matrix &r);
+        static void MultiplyAVX(const Matrix &a, const Matrix &b, Matrix &r);
+    #endif
+        static MultiplyFunction SelectMultiply();
+    
+        static bool HasSSE();
+        static bool HasAVX();
+    
+        // sine and cosine of one angle together, used by all the rotation setters.
+        // with fastTrig set they come from a polynomial instead of the C library,
+        // max absolute error 4e-7 for |angle| < 1000 and 1.1e-6 for |angle| < 100000.
+        static bool fastTrig;
+        static void SinCos(float angle, float &sine, float &cosine);
+        static void SinCosFast(float angle, float &sine, float &cosine);
+    
+        // batch versions for rotating many sprites a frame, vectorized when fastTrig is set
+        static void SinCos(const float *angles, float *sines, float *cosines, int count);
+        static void SetRoll(Matrix *matrices, const float *rolls, int count);
 };
+
+constexpr void Matrix::Identity() {
+    m[0][0] = 1.0;
+    m[1][0] = 0.0;
+    m[2][0] = 0.0;
+    m[3][0] = 0.0;
+    
+    m[0][1] = 0.0;
+    m[1][1] = 1.0;
+    m[2][1] = 0.0;
+    m[3][1] = 0.0;
+
+    m[0][2] = 0.0;
+    m[1][2] = 0.0;
+    m[2][2] = 1.0;
+    m[3][2] = 0.0;
+
+    m[0][3] = 0.0;
+    m[1][3] = 0.0;
+    m[2][3] = 0.0;
+    m[3][3] = 1.0;
+}
+
+constexpr void Matrix::SetPosition(float x, float y, float z) {
+    m[3][0] = x;
+    m[3][1] = y;
+    m[3][2] = z;
+}
+
+constexpr void Matrix::SetScale(float x, float y, float z) {
+    m[0][0] = x;
+    m[1][1] = y;
+    m[2][2] = z;
+}
+
+constexpr void Matrix::SetOrthoProjection(float left, float right, float bottom, float top, float zNear, float zFar) {
+    m[0][0] = 2.0f/(right-left);
+    m[1][1] = 2.0f/(top-bottom);
+    m[2][2] = -2.0f/(zFar-zNear);
+
+    m[3][0] = -((right+left)/(right-left));
+    m[3][1] = -((top+bottom)/(top-bottom));
+    m[3][2] = -((zFar+zNear)/(zFar-zNear));
+}
+
+constexpr void Matrix::SetPerspectiveProjection(float fov, float aspect, float zNear, float zFar) {
+    m[0][0] = 1.0f/(float)Tangent(fov/2.0)/aspect;
+    m[1][1] = 1.0f/(float)Tangent(fov/2.0);
+    m[2][2] = (zFar+zNear)/(zNear-zFar);
+    m[3][2] = (2.0f*zFar*zNear)/(zNear-zFar);
+    m[2][3] = -1.0f;
+    m[3][3] = 0.0f;
+}
+
+constexpr Matrix Matrix::Translation(float x, float y, float z) {
+    Matrix matrix;
+    matrix.SetPosition(x, y, z);
+    return matrix;
+}
+
+constexpr Matrix Matrix::Scaling(float x, float y, float z) {
+    Matrix matrix;
+    matrix.SetScale(x, y, z);
+    return matrix;
+}
+
+constexpr Matrix Matrix::OrthoProjection(float left, float right, float bottom, float top, float zNear, float zFar) {
+    Matrix matrix;
+    matrix.SetOrthoProjection(left, right, bottom, top, zNear, zFar);
+    return matrix;
+}
+
+constexpr Matrix Matrix::PerspectiveProjection(float fov, float aspect, float zNear, float zFar) {
+    Matrix matrix;
+    matrix.SetPerspectiveProjection(fov, aspect, zNear, zFar);
+    return matrix;
+}
+
+constexpr double Matrix::Tangent(double x) {
+    // x / (1 - x^2 / (3 - x^2 / (5 - ...))) evaluated from the bottom up
+    double x2 = x * x;
+    double fraction = 25.0;
+    for(int i = 11; i >= 0; i--) {
+        fraction = (2 * i + 1) - x2 / fraction;
+    }
+    return x / fraction;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Matrix.h"
+
+// 2x3 affine transform for the 2D games, laid out like the first two columns and the
+// translation of a Matrix:
+//
+//  | a  c  tx |
+//  | b  d  ty |
+//
+// Composition order is the same as Matrix, so Translate/Scale/Roll and operator * can be
+// swapped in for a Matrix model matrix. Convert with ToMatrix() only when uploading to a shader.
+class Transform2D {
+    public:
+    
+        Transform2D();
+        Transform2D(float a, float b, float c, float d, float tx, float ty);
+    
+        float a, b, c, d;
+        float tx, ty;
+    
+        void Identity();
+        Transform2D operator * (const Transform2D &t2) const;
+        Transform2D Inverse() const;
+    
+        void Translate(float x, float y);
+        void Scale(float x, float y);
+        void Rotate(float rotation);
+        void Roll(float roll);
+    
+        void SetPosition(float x, float y);
+        void SetScale(float x, float y);
+        void SetRotation(float rotation);
+        void SetRoll(float roll);
+    
+        void TransformPoint(float &x, float &y) const;
+    
+        void ToMatrix(Matrix &matrix) const;
+        Matrix ToMatrix() const;
+};
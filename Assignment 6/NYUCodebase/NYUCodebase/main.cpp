@@ -7,7 +7,19 @@
 #include <SDL_opengl.h>
 #include <SDL_image.h>
 #include "ShaderProgram.h"
+#include "TextureManager.h"
+#include "CookedTexture.h"
 #include "Matrix.h"
+#include "Transform2D.h"
+#include "TransformNode.h"
+#include "Benchmark.h"
+#include "TextureLoader.h"
+#include "SpriteBatch.h"
+#include "InstancedSpriteBatch.h"
+#include "VertexRing.h"
+#include "QuadIndexBuffer.h"
+#include "RenderQueue.h"
+#include "CameraRect.h"
 #include "stb_image.h"
 #include <vector>
 #include <windows.h>
@@ -32,21 +44,23 @@
 
 SDL_Window* displayWindow;
 
+//Textures loaded up front go through the manager, so loading the same file twice shares one texture.
+//The sprite sheet comes from the TextureLoader instead, which deletes it in its own Cleanup
+TextureManager textureManager;
+
+//Every frame's vertices are streamed through this instead of being copied out of client arrays by the driver
+VertexRing vertexRing;
+
+//Sprites and text are queued through the frame and drawn sorted by state at the end of Render
+RenderQueue renderQueue;
+//Queue layers, drawn in this order
+enum RenderLayer { LAYER_SPRITES, LAYER_TEXT };
+
 //Function to load texture as unsigned int
 GLuint LoadTexture(const char *filePath) {
-	int w, h, comp;
-	unsigned char* image = stbi_load(filePath, &w, &h, &comp, STBI_rgb_alpha);
-	if (image == NULL) {
-		std::cout << "Unable to load image. Make sure the path is correct\n";
-		assert(false);
-	}
-	GLuint retTexture;
-	glGenTextures(1, &retTexture);
-	glBindTexture(GL_TEXTURE_2D, retTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	stbi_image_free(image);
+	GLuint retTexture = textureManager.Acquire(filePath);
+	//Acquire already printed which file failed
+	assert(retTexture != 0);
 	return retTexture;
 }
 
@@ -57,6 +71,8 @@ public:
 	SheetSprite(unsigned int textureID, float u, float v, float width, float height, float size) : textureID(textureID), u(u), v(v), width(width), height(height), size(size) {}
 
 	void Draw(ShaderProgram *program);
+	void Draw(RenderQueue &queue, ShaderProgram *program, const Transform2D &transform);
+	void Draw(InstancedSpriteBatch &batch, float x, float y, float rotation);
 
 	float size;
 	unsigned int textureID;
@@ -70,12 +86,11 @@ public:
 void SheetSprite::Draw(ShaderProgram *program) {
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
+	//Corners in the shared index buffer's order: bottom left, top right, top left, bottom right
 	GLfloat texCoords[] = {
 		u, v + height,
 		u + width, v,
 		u, v,
-		u + width, v,
-		u, v + height,
 		u + width, v + height
 	};
 
@@ -84,62 +99,66 @@ void SheetSprite::Draw(ShaderProgram *program) {
 		-0.5f * size * aspect, -0.5f * size,
 		0.5f * size * aspect, 0.5f * size,
 		-0.5f * size * aspect, 0.5f * size,
-		0.5f * size * aspect, 0.5f * size,
-		-0.5f * size * aspect, -0.5f * size,
 		0.5f * size * aspect, -0.5f * size
 	};
 
 	//draw our arrays
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertices);
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoords);
-	glEnableVertexAttribArray(program->texCoordAttribute);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
+	program->layout.Bind(!vertexRing.Reserve(sizeof(vertices) + sizeof(texCoords), 2));
+	program->layout.Pointer(0, vertexRing.Stream(vertices, sizeof(vertices)));
+	program->layout.Pointer(1, vertexRing.Stream(texCoords, sizeof(texCoords)));
+	QuadIndexBuffer::Shared().Draw(1, 4 * sizeof(float));
+	program->layout.Unbind();
+	vertexRing.Unbind();
 }
 
+//Draw, queue the sprite, it gets sorted in with everything else drawn this frame
+void SheetSprite::Draw(RenderQueue &queue, ShaderProgram *program, const Transform2D &transform) {
+	float aspect = width / height;
+	RenderCommand command;
+	command.program = program;
+	command.texture = textureID;
+	command.blend = RENDER_BLEND_ALPHA;
+	command.transform = transform;
+	command.left = -0.5f * size * aspect;
+	command.bottom = -0.5f * size;
+	command.right = 0.5f * size * aspect;
+	command.top = 0.5f * size;
+	command.u0 = u;
+	command.v0 = v;
+	command.u1 = u + width;
+	command.v1 = v + height;
+	queue.Add(command, LAYER_SPRITES);
+}
 
-void DrawText(ShaderProgram *program, int fontTexture, std::string text, float size, float spacing) {
+//Draw, only the placement and sheet region go to the GPU, the shader builds the quad
+void SheetSprite::Draw(InstancedSpriteBatch &batch, float x, float y, float rotation) {
+	float aspect = width / height;
+	batch.Draw(textureID, x, y, size * aspect, size, rotation, u, v, u + width, v + height);
+}
+
+
+//Queue a line of text, one command per letter. Added in order at the same depth, so they stay in order
+void DrawText(RenderQueue &queue, ShaderProgram *program, int fontTexture, std::string text, float size, float spacing, const Matrix &modelMatrix) {
 	float texture_size = 1.0 / 16.0f;
-	std::vector<float> vertexData;
-	std::vector<float> texCoordData;
+	RenderCommand command;
+	command.program = program;
+	command.texture = fontTexture;
+	command.blend = RENDER_BLEND_ALPHA;
+	command.transform = Transform2D(modelMatrix.m[0][0], modelMatrix.m[0][1], modelMatrix.m[1][0], modelMatrix.m[1][1], modelMatrix.m[3][0], modelMatrix.m[3][1]);
 	for (int i = 0; i < text.size(); i++) {
 		int spriteIndex = (int)text[i];
 		float texture_x = (float)(spriteIndex % 16) / 16.0f;
 		float texture_y = (float)(spriteIndex / 16) / 16.0f;
-		vertexData.insert(vertexData.end(), {
-			((size + spacing) * i) + (-0.5f * size), 0.5f * size,
-			((size + spacing) * i) + (-0.5f * size), -0.5f * size,
-			((size + spacing) * i) + (0.5f * size), 0.5f * size,
-			((size + spacing) * i) + (0.5f * size), -0.5f * size,
-			((size + spacing) * i) + (0.5f * size), 0.5f * size,
-			((size + spacing) * i) + (-0.5f * size), -0.5f * size,
-			});
-		texCoordData.insert(texCoordData.end(), {
-			texture_x, texture_y,
-			texture_x, texture_y + texture_size,
-			texture_x + texture_size, texture_y,
-			texture_x + texture_size, texture_y + texture_size,
-			texture_x + texture_size, texture_y,
-			texture_x, texture_y + texture_size,
-			});
-	}
-	glBindTexture(GL_TEXTURE_2D, fontTexture);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
-
-	// draw this data (use the .data() method of std::vector to get pointer to data)
-	glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertexData.data());
-	glEnableVertexAttribArray(program->positionAttribute);
-	glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texCoordData.data());
-	glEnableVertexAttribArray(program->texCoordAttribute);
-
-	glDrawArrays(GL_TRIANGLES, 0, 6 * text.size());
-
-	glDisableVertexAttribArray(program->positionAttribute);
-	glDisableVertexAttribArray(program->texCoordAttribute);
-
+		command.left = ((size + spacing) * i) + (-0.5f * size);
+		command.bottom = -0.5f * size;
+		command.right = ((size + spacing) * i) + (0.5f * size);
+		command.top = 0.5f * size;
+		command.u0 = texture_x;
+		command.v0 = texture_y;
+		command.u1 = texture_x + texture_size;
+		command.v1 = texture_y + texture_size;
+		queue.Add(command, LAYER_TEXT);
+	}
 }
 
 //Simple vector class
@@ -159,6 +178,12 @@ public:
 	void Draw(ShaderProgram *program) {
 		sprite.Draw(program);
 	}
+	void Draw(RenderQueue &queue, ShaderProgram *program, const Transform2D &transform) {
+		sprite.Draw(queue, program, transform);
+	}
+	void Draw(InstancedSpriteBatch &batch, const Transform2D &transform) {
+		sprite.Draw(batch, transform.tx, transform.ty, rotation);
+	}
 
 	void Update(float elapsed) {
 		position.x += elapsed * velocity.x;
@@ -166,6 +191,14 @@ public:
 		position.z += elapsed * velocity.z;
 	}
 
+	//Moves the node to the entity's position, only when it moved so the cached world matrix stays valid otherwise
+	void UpdateNode() {
+		const Matrix &local = node.GetLocalMatrix();
+		if (local.m[3][0] != position.x || local.m[3][1] != position.y || local.m[3][2] != position.z) {
+			node.SetPosition(position.x, position.y, position.z);
+		}
+	}
+
 	Vector3 position;
 	Vector3 velocity;
 	Vector3 size;
@@ -174,6 +207,7 @@ public:
 	float rotation;
 
 	SheetSprite sprite;
+	TransformNode node;
 };
 
 class GameState {
@@ -190,18 +224,31 @@ GameMode mode;
 GameState state;
 
 //Player Globals
-Matrix projectionMatrix;
+constexpr Matrix projectionMatrix = Matrix::OrthoProjection(-5.33f, 5.33f, -3.0f, 3.0f, -1.0f, 1.0f);
 Matrix modelMatrix;
 Matrix viewMatrix;
-Matrix playerModelMatrix;
-Matrix enemyModelMatrix;
-Matrix bulletModelMatrix;
+//Every entity's node hangs off this one, moving it moves the whole level
+TransformNode levelNode;
+//What the camera sees this frame, sprites outside it aren't submitted
+CameraRect cameraRect;
+
+//How the level's sprites get to GL, picked with --sprites immediate|batched|instanced to compare them
+enum SpriteRenderMode { SPRITES_IMMEDIATE, SPRITES_BATCHED, SPRITES_INSTANCED };
+SpriteRenderMode spriteRenderMode = SPRITES_BATCHED;
+
+//Same, but only one instance per sprite goes to the GPU, drawn with its own program
+InstancedSpriteBatch instancedSpriteBatch;
+ShaderProgram instancedProgram;
 
-Matrix titleModelMatrix;
-Matrix commandModelMatrix;
+//Menu text positions are fixed, so their world matrices are computed once and cached by the nodes.
+//The command line is placed relative to the title
+TransformNode titleNode;
+TransformNode commandNode;
 
 GLuint textTexture;
 GLuint spriteSheetTexture;
+//The sprite sheet loads in the background, the game can't start before it's uploaded
+bool spriteSheetReady = false;
 
 //Audio
 std::map<std::string, Mix_Chunk*> sounds;
@@ -242,12 +289,10 @@ void ProcessGameInput(float elapsed) {
 
 	if (keys[SDL_SCANCODE_RIGHT]) {
 		state.player.position.x += elapsed * 2.5;
-		playerModelMatrix.Translate(elapsed * 2.5, 0.0, 0.0);
 		//OutputDebugString(std::to_string(3.14));
 	}
 	if (keys[SDL_SCANCODE_LEFT]) {
 		state.player.position.x -= elapsed * 2.5;
-		playerModelMatrix.Translate(elapsed * -2.5, 0.0, 0.0);
 	}
 
 }
@@ -255,7 +300,7 @@ void ProcessGameInput(float elapsed) {
 //Process events for menu, only polling events
 void ProcessMenuPollingInput(SDL_Event& event) {
 	if (event.type == SDL_KEYDOWN) {
-		if (event.key.keysym.scancode == SDL_SCANCODE_SPACE) {
+		if (event.key.keysym.scancode == SDL_SCANCODE_SPACE && spriteSheetReady) {
 			mode = STATE_GAME_LEVEL;
 		}
 	}
@@ -345,10 +390,40 @@ void Update(float elapsed) {
 }
 
 void RenderMenu(ShaderProgram *program) {
-	program->SetModelMatrix(titleModelMatrix);
-	DrawText(program, textTexture, "Space Invaders", 0.30, 0.05);
-	program->SetModelMatrix(commandModelMatrix);
-	DrawText(program, textTexture, "Press SPACE to Start", 0.20, -0.05);
+	DrawText(renderQueue, program, textTexture, "Space Invaders", 0.30, 0.05, titleNode.GetWorldMatrix());
+	if (spriteSheetReady) {
+		DrawText(renderQueue, program, textTexture, "Press SPACE to Start", 0.20, -0.05, commandNode.GetWorldMatrix());
+	}
+	else {
+		DrawText(renderQueue, program, textTexture, "Loading...", 0.20, -0.05, commandNode.GetWorldMatrix());
+	}
+}
+
+//Draw an entity with whichever sprite path is picked, the batches are started and ended by Render
+void DrawEntity(ShaderProgram *program, Entity &entity) {
+	entity.UpdateNode();
+	const Matrix &world = entity.node.GetWorldMatrix();
+	Transform2D transform(world.m[0][0], world.m[0][1], world.m[1][0], world.m[1][1], world.m[3][0], world.m[3][1]);
+	//Off camera, tested with the circle around the sprite so a rotated corner can't poke into view unseen
+	float halfWidth = 0.5f * entity.sprite.size * entity.sprite.width / entity.sprite.height;
+	float halfHeight = 0.5f * entity.sprite.size;
+	float radius = sqrtf(halfWidth * halfWidth + halfHeight * halfHeight);
+	if (!cameraRect.Visible(transform.tx, transform.ty, radius, radius)) {
+		return;
+	}
+	switch (spriteRenderMode) {
+	case SPRITES_IMMEDIATE:
+		//Not uploaded again while the entity's node hasn't moved since this program last drew it
+		program->SetModelMatrix(entity.node);
+		entity.Draw(program);
+		break;
+	case SPRITES_BATCHED:
+		entity.Draw(renderQueue, program, transform);
+		break;
+	case SPRITES_INSTANCED:
+		entity.Draw(instancedSpriteBatch, transform);
+		break;
+	}
 }
 
 void Render(ShaderProgram *program) {
@@ -357,33 +432,52 @@ void Render(ShaderProgram *program) {
 		RenderMenu(program);
 		break;
 	case STATE_GAME_LEVEL:
-		program->SetModelMatrix(playerModelMatrix);
-		state.player.Draw(program);
+		cameraRect.Set(viewMatrix, projectionMatrix);
+		//Everything in the level is on the sprite sheet, so queued or instanced the whole level is one draw
+		if (spriteRenderMode == SPRITES_INSTANCED) {
+			instancedSpriteBatch.Begin(&instancedProgram);
+		}
+		DrawEntity(program, state.player);
 
 		for (int i = 0; i < 32; i++) {
 			if (state.enemy[i].dead == false) {
-				enemyModelMatrix.SetPosition(state.enemy[i].position.x, state.enemy[i].position.y, 0.0);
-				program->SetModelMatrix(enemyModelMatrix);
-				state.enemy[i].Draw(program);
+				DrawEntity(program, state.enemy[i]);
 			}
 		}
 
 		for (int i = 0; i < MAX_BULLETS - 1; i++) {
 			if (state.bullets[i].dead == false) {
-				bulletModelMatrix.SetPosition(state.bullets[i].position.x, state.bullets[i].position.y, 0.0);
-				program->SetModelMatrix(bulletModelMatrix);
-				state.bullets[i].Draw(program);
+				DrawEntity(program, state.bullets[i]);
 			}
 		}
 
+		if (spriteRenderMode == SPRITES_INSTANCED) {
+			instancedSpriteBatch.End();
+			program->Use();
+		}
 		break;
 	}
+	//Everything queued this frame, sorted so each texture is drawn once
+	renderQueue.Submit();
 }
 
 
 
 int main(int argc, char *argv[])
 {
+	//Cook the textures into .ctex files with mip chains and exit, the game loads those instead of the PNGs when they exist
+	if (argc > 1 && std::string(argv[1]) == "--cook-textures") {
+		bool cooked = CookedTexture::Cook("sheet.png", CookedTexture::CookedPath("sheet.png"));
+		cooked = CookedTexture::Cook(RESOURCE_FOLDER"pixel_font.png", CookedTexture::CookedPath(RESOURCE_FOLDER"pixel_font.png")) && cooked;
+		return cooked ? 0 : 1;
+	}
+
+	//Check the SIMD matrix multiply and inverse against the scalar ones and exit, nonzero when any of them is off:
+	//NYUCodebase.exe --selftest
+	if (argc > 1 && std::string(argv[1]) == "--selftest") {
+		return RunMatrixSelfTests() ? 0 : 1;
+	}
+
 	SDL_Init(SDL_INIT_VIDEO);
 
 	displayWindow = SDL_CreateWindow("Assignment 3: Space Invaders", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640 * 2, 360 * 2, SDL_WINDOW_OPENGL);
@@ -400,10 +494,95 @@ int main(int argc, char *argv[])
 	//Load the shader program
 	ShaderProgram program;
 	//WE'RE GONNA WANT THE TEXTURED VERTEX SHADER AND FRAGMENT SHADER
-	program.Load(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
+	program.Submit(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
+	//Compiles in the background, it gets finished the first time the program is used
+
+	//Run the math and shader upload benchmarks instead of the game, the Benchmark project in the solution runs them without it:
+	//NYUCodebase.exe --bench [--bench-warmup N] [--bench-iterations N] [--bench-decode-iterations N] [--bench-frame-iterations N] [--bench-sprites N] [--bench-output file.json]
+	bool runBenchmarks = false;
+	long long benchWarmup = 10000;
+	long long benchIterations = 1000000;
+	long long benchDecodeIterations = 50;
+	long long benchFrameIterations = 100;
+	int benchSprites = 10000;
+	const char *benchOutput = "benchmark.json";
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--bench") {
+			runBenchmarks = true;
+		}
+		else if (arg == "--bench-warmup" && i + 1 < argc) {
+			benchWarmup = atoll(argv[++i]);
+		}
+		else if (arg == "--bench-iterations" && i + 1 < argc) {
+			benchIterations = atoll(argv[++i]);
+		}
+		else if (arg == "--bench-decode-iterations" && i + 1 < argc) {
+			benchDecodeIterations = atoll(argv[++i]);
+		}
+		else if (arg == "--bench-frame-iterations" && i + 1 < argc) {
+			benchFrameIterations = atoll(argv[++i]);
+		}
+		else if (arg == "--bench-sprites" && i + 1 < argc) {
+			benchSprites = atoi(argv[++i]);
+		}
+		else if (arg == "--bench-output" && i + 1 < argc) {
+			benchOutput = argv[++i];
+		}
+		else if (arg == "--sprites" && i + 1 < argc) {
+			std::string sprites = argv[++i];
+			if (sprites == "immediate") {
+				spriteRenderMode = SPRITES_IMMEDIATE;
+			}
+			else if (sprites == "instanced") {
+				spriteRenderMode = SPRITES_INSTANCED;
+			}
+			else {
+				spriteRenderMode = SPRITES_BATCHED;
+			}
+		}
+	}
+	if (spriteRenderMode == SPRITES_INSTANCED && !InstancedSpriteBatch::Supported()) {
+		std::cout << "Instanced drawing isn't supported, using the sprite batch" << std::endl;
+		spriteRenderMode = SPRITES_BATCHED;
+	}
+	//The instanced program is the same shaders built with INSTANCED
+	if ((spriteRenderMode == SPRITES_INSTANCED || runBenchmarks) && InstancedSpriteBatch::Supported()) {
+		instancedProgram.Submit(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl", INSTANCED_SPRITE_DEFINES);
+	}
+	if (runBenchmarks) {
+		Benchmark benchmark(benchWarmup, benchIterations);
+		RunMatrixBenchmarks(benchmark);
+		RunShaderProgramBenchmarks(benchmark, program);
+		//Decoding is milliseconds a call, it gets its own iteration count and shares the report
+		Benchmark decodeBenchmark(2, benchDecodeIterations);
+		std::vector<std::string> decodeImages;
+		decodeImages.push_back("sheet.png");
+		decodeImages.push_back(RESOURCE_FOLDER"pixel_font.png");
+		RunImageDecodeBenchmarks(decodeBenchmark, decodeImages);
+		benchmark.results.insert(benchmark.results.end(), decodeBenchmark.results.begin(), decodeBenchmark.results.end());
+		//Same for whole frames of sprites
+		Benchmark frameBenchmark(5, benchFrameIterations);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLuint benchSheet = LoadTexture("sheet.png");
+		RunSpriteBenchmarks(frameBenchmark, program, benchSheet, benchSprites, InstancedSpriteBatch::Supported() ? &instancedProgram : NULL, &vertexRing);
+		RunRenderQueueBenchmarks(frameBenchmark, program, benchSheet, LoadTexture(RESOURCE_FOLDER"pixel_font.png"), benchSprites);
+		benchmark.results.insert(benchmark.results.end(), frameBenchmark.results.begin(), frameBenchmark.results.end());
+		benchmark.PrintResults();
+		benchmark.WriteJSON(benchOutput);
+		textureManager.Cleanup();
+		vertexRing.Cleanup();
+		QuadIndexBuffer::Shared().Cleanup();
+		instancedProgram.Cleanup();
+		program.Cleanup();
+		SDL_Quit();
+		return 0;
+	}
 
-	//Setting up the Sprite sheet
-	spriteSheetTexture = LoadTexture("sheet.png");
+	//Setting up the Sprite sheet, decoded on worker threads while the menu is up
+	TextureLoader textureLoader;
+	spriteSheetTexture = textureLoader.Load("sheet.png");
 	//Setting up the text sheet
 	textTexture = LoadTexture(RESOURCE_FOLDER"pixel_font.png");
 	
@@ -449,8 +628,13 @@ int main(int argc, char *argv[])
 		state.bullets[i].dead = false;
 	}
 
-	//Sets an orthographic projection in a matrix
-	projectionMatrix.SetOrthoProjection(-5.33f, 5.33f, -3.0f, 3.0f, -1.0f, 1.0f);
+	//The batches stream their flushes through the ring too
+	renderQueue.batch.ring = &vertexRing;
+	//The whole level is within 8 units of the origin, so sprites and text go as packed vertices
+	//in steps of 1/4096 of a unit
+	renderQueue.batch.packed = true;
+	renderQueue.batch.positionScale = 4096.0f;
+	instancedSpriteBatch.ring = &vertexRing;
 
 	//Enable blending
 	glEnable(GL_BLEND);
@@ -458,6 +642,7 @@ int main(int argc, char *argv[])
 
 	//This is how we will keep track of time
 	float lastFrameTicks = 0.0;
+	float lastTitleTicks = 0.0;
 	float angle = 0.0; 
 	float accumulator = 0.0;
 
@@ -467,9 +652,20 @@ int main(int argc, char *argv[])
 	//Set clear color of screen
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		
+	//Setup the menu text and the level's nodes
+	titleNode.SetPosition(-2.25f, 0.75f, 0.0f);
+	commandNode.SetPosition(0.95f, -1.0f, 0.0f);
+	commandNode.SetParent(&titleNode);
+	state.player.node.SetParent(&levelNode);
+	for (int i = 0; i < 32; i++) {
+		state.enemy[i].node.SetParent(&levelNode);
+	}
+	for (int i = 0; i < MAX_BULLETS - 1; i++) {
+		state.bullets[i].node.SetParent(&levelNode);
+	}
+
 	//Setup initial player position
-	playerModelMatrix.Translate(0, -2.25, 0);
-	program.SetModelMatrix(playerModelMatrix);
+	state.player.position.y = -2.25;
 
 	//Setup intial bullets position
 	for (int i = 0; i < MAX_BULLETS - 1; i++) {
@@ -499,10 +695,6 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	//Setup intial Menu text positions
-	titleModelMatrix.Translate(-2.25, 0.75, 0.0);
-	commandModelMatrix.Translate(-1.30, -0.25, 0.0);
-
 	mode = STATE_MAIN_MENU;
 
 	Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096);
@@ -532,13 +724,16 @@ int main(int argc, char *argv[])
 
 		glClear(GL_COLOR_BUFFER_BIT);
 
+		//Upload whatever the texture workers finished
+		textureLoader.Update();
+		spriteSheetReady = textureLoader.IsReady(spriteSheetTexture);
+
 		//Use the specified program ID
-		glUseProgram(program.programID);
+		program.Use();
 
-		//Pass the matrices to our program
+		//Pass the matrices to our program, the camera goes to every program at once
 		program.SetModelMatrix(modelMatrix);
-		program.SetProjectionMatrix(projectionMatrix);
-		program.SetViewMatrix(viewMatrix);
+		ShaderProgram::SetCamera(viewMatrix, projectionMatrix);
 
 		float ticks = (float)SDL_GetTicks() / 1000.0;
 		float elapsed = ticks - lastFrameTicks;
@@ -561,8 +756,28 @@ int main(int argc, char *argv[])
 		Render(&program);
 
 		SDL_GL_SwapWindow(displayWindow);
+		//Next frame writes to the next region of the ring
+		vertexRing.EndFrame();
+
+		//Vertex bytes the indexed quads saved and what culling left out, shown in the title once a second
+		QuadIndexBuffer::Shared().EndFrame();
+		if (ticks - lastTitleTicks >= 1.0f) {
+			lastTitleTicks = ticks;
+			std::string title = "Assignment 3: Space Invaders - " + std::to_string(QuadIndexBuffer::Shared().lastFrameBytesSaved) + " vertex bytes saved per frame";
+			//The menu doesn't Set the camera rect, the counts are only this frame's during the level
+			if (mode == STATE_GAME_LEVEL) {
+				title += ", " + std::to_string(cameraRect.drawn) + " sprites drawn, " + std::to_string(cameraRect.culled) + " culled";
+			}
+			SDL_SetWindowTitle(displayWindow, title.c_str());
+		}
 	}
 
+	textureLoader.Cleanup();
+	textureManager.Cleanup();
+	instancedSpriteBatch.Cleanup();
+	vertexRing.Cleanup();
+	QuadIndexBuffer::Shared().Cleanup();
+	instancedProgram.Cleanup();
 	SDL_Quit();
 	return 0;
 }
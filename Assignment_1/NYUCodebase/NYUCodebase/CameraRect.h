@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Matrix.h"
+
+// the part of the world an orthographic camera sees, as an axis aligned rect worked out from the
+// view and projection matrices the shaders get. Set it once a frame after moving the camera, then
+// only submit what's Visible:
+//
+//  cameraRect.Set(viewMatrix, projectionMatrix);
+//  if(cameraRect.Visible(x, y, radius, radius)) {
+//      ...
+//  }
+//
+// drawn and culled count the Visible calls since Set, for reporting
+class CameraRect {
+    public:
+
+        CameraRect();
+
+        void Set(const Matrix &viewMatrix, const Matrix &projectionMatrix);
+        // true when the box centred on x, y overlaps the rect. counts it as drawn or culled
+        bool Visible(float x, float y, float halfWidth, float halfHeight);
+
+        float left, bottom, right, top;
+
+        int drawn;
+        int culled;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+
+// steps a unit a packed sprite position is stored in by default. positions round to 1/1024 of a
+// unit, about an eighth of a pixel at 1280 pixels for 10 units, and have to stay within 32 units
+// of the origin
+#define PACKED_POSITION_SCALE 1024.0f
+
+// a position and texCoord in 8 bytes, against 16 as two float2s. GL decodes it as it fetches the
+// vertex: the texCoord is normalized, 0 to 65535 reads as 0.0 to 1.0, and the position comes in as
+// the plain integer, so whoever draws puts 1 / scale into the model matrix. That keeps it to the one
+// shader for both formats. Tile maps are scale 1, their corners are whole tiles
+struct PackedVertex {
+    short x, y;
+    unsigned short u, v;
+};
+
+// rounds to the nearest step and clamps to what 16 bits hold
+short PackPosition(float position, float scale);
+// clamps to 0..1, wrapping texCoords can't be packed
+unsigned short PackTexCoord(float texCoord);
+// interleaves count float2 positions and texCoords into count packed vertices
+void PackVertices(const float *positions, const float *texCoords, size_t count, float positionScale, PackedVertex *packed);
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <vector>
+
+// 16 bit indices, so a draw can reach 65536 vertices
+#define QUAD_INDEX_MAX_QUADS 16384
+
+// one static index buffer for every quad the games draw. Quads are 4 vertices instead of 6, in the
+// order bottom left, top right, top left, bottom right, and the indices make the same two triangles
+// SheetSprite::Draw always drew: 0 1 2 and 1 0 3. Built once for the largest batch, every quad
+// renderer shares it through Shared()
+class QuadIndexBuffer {
+    public:
+
+        QuadIndexBuffer(int maxQuads = QUAD_INDEX_MAX_QUADS);
+
+        static QuadIndexBuffer &Shared();
+
+        // draws quadCount quads, at most maxQuads, from the attributes already set up.
+        // vertexBytes is the size of one vertex, for the bytes saved counter
+        void Draw(int quadCount, int vertexBytes);
+        // moves the saved bytes counter over to lastFrameBytesSaved
+        void EndFrame();
+        void Cleanup();
+
+        GLuint buffer;
+        int maxQuads;
+        // kept for the platforms that draw from client memory
+        std::vector<unsigned short> indices;
+
+        // vertex bytes that didn't have to be written compared with 6 vertices a quad
+        unsigned long long frameBytesSaved;
+        unsigned long long lastFrameBytesSaved;
+};
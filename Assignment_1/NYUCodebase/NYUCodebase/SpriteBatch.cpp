@@ -0,0 +1,105 @@
+#include "SpriteBatch.h"
+#include "QuadIndexBuffer.h"
+#include <stddef.h>
+
+SpriteBatch::SpriteBatch() : program(NULL), texture(0), ring(NULL), packed(false), positionScale(PACKED_POSITION_SCALE), sprites(0), drawCalls(0) {}
+
+void SpriteBatch::Begin(ShaderProgram *program) {
+    this->program = program;
+    texture = 0;
+    sprites = 0;
+    drawCalls = 0;
+    vertices.clear();
+    texCoords.clear();
+    program->Use();
+    // positions are already in world space, packed ones in steps of 1 / positionScale
+    program->SetModelMatrix(packed ? Matrix::Scaling(1.0f / positionScale, 1.0f / positionScale, 1.0f) : Matrix());
+}
+
+void SpriteBatch::Draw(GLuint texture, const Transform2D &transform, float left, float bottom, float right, float top, float u0, float v0, float u1, float v1) {
+    if(texture != this->texture || vertices.size() / 8 >= (size_t)QuadIndexBuffer::Shared().maxQuads) {
+        Flush();
+        this->texture = texture;
+    }
+
+    // the four corners, the shared index buffer makes the two triangles
+    float leftX = transform.a * left + transform.tx;
+    float leftY = transform.b * left + transform.ty;
+    float rightX = transform.a * right + transform.tx;
+    float rightY = transform.b * right + transform.ty;
+    float bottomX = transform.c * bottom;
+    float bottomY = transform.d * bottom;
+    float topX = transform.c * top;
+    float topY = transform.d * top;
+
+    float bottomLeftX = leftX + bottomX, bottomLeftY = leftY + bottomY;
+    float bottomRightX = rightX + bottomX, bottomRightY = rightY + bottomY;
+    float topLeftX = leftX + topX, topLeftY = leftY + topY;
+    float topRightX = rightX + topX, topRightY = rightY + topY;
+
+    vertices.insert(vertices.end(), {
+        bottomLeftX, bottomLeftY,
+        topRightX, topRightY,
+        topLeftX, topLeftY,
+        bottomRightX, bottomRightY
+    });
+    texCoords.insert(texCoords.end(), {
+        u0, v1,
+        u1, v0,
+        u0, v0,
+        u1, v1
+    });
+    sprites++;
+}
+
+void SpriteBatch::Draw(GLuint texture, const Transform2D &transform, const float *vertices, const float *texCoords, int quadCount) {
+    if(texture != this->texture || this->vertices.size() / 8 + quadCount > (size_t)QuadIndexBuffer::Shared().maxQuads) {
+        Flush();
+        this->texture = texture;
+    }
+    size_t start = this->vertices.size();
+    this->vertices.insert(this->vertices.end(), vertices, vertices + quadCount * 8);
+    this->texCoords.insert(this->texCoords.end(), texCoords, texCoords + quadCount * 8);
+    for(size_t i = start; i < this->vertices.size(); i += 2) {
+        transform.TransformPoint(this->vertices[i], this->vertices[i + 1]);
+    }
+    sprites++;
+}
+
+void SpriteBatch::Flush() {
+    if(vertices.empty()) {
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if(packed) {
+        packedVertices.resize(vertices.size() / 2);
+        PackVertices(vertices.data(), texCoords.data(), packedVertices.size(), positionScale, packedVertices.data());
+        size_t bytes = packedVertices.size() * sizeof(PackedVertex);
+        bool streamed = ring && ring->Reserve(bytes);
+        const char *base = streamed ? (const char *)ring->Stream(packedVertices.data(), bytes) : (const char *)packedVertices.data();
+        program->packedLayout.Bind(!streamed);
+        program->packedLayout.Pointer(0, base + offsetof(PackedVertex, x));
+        program->packedLayout.Pointer(1, base + offsetof(PackedVertex, u));
+        QuadIndexBuffer::Shared().Draw((int)(vertices.size() / 8), sizeof(PackedVertex));
+        program->packedLayout.Unbind();
+    } else {
+        size_t bytes = vertices.size() * sizeof(float);
+        bool streamed = ring && ring->Reserve(2 * bytes, 2);
+        program->layout.Bind(!streamed);
+        program->layout.Pointer(0, streamed ? ring->Stream(vertices.data(), bytes) : vertices.data());
+        program->layout.Pointer(1, streamed ? ring->Stream(texCoords.data(), bytes) : texCoords.data());
+        QuadIndexBuffer::Shared().Draw((int)(vertices.size() / 8), 4 * sizeof(float));
+        program->layout.Unbind();
+    }
+    if(ring) {
+        ring->Unbind();
+    }
+    drawCalls++;
+    // clear keeps the capacity, after the first few frames nothing gets allocated
+    vertices.clear();
+    texCoords.clear();
+}
+
+void SpriteBatch::End() {
+    Flush();
+}
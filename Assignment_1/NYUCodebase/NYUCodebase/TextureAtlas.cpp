@@ -0,0 +1,235 @@
+#include "TextureAtlas.h"
+#include "stb_image.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+AtlasRegion::AtlasRegion() : x(0), y(0), width(0), height(0), u0(0.0f), v0(0.0f), u1(1.0f), v1(1.0f) {}
+
+float AtlasRegion::U(float u) const {
+    return u0 + u * (u1 - u0);
+}
+
+float AtlasRegion::V(float v) const {
+    return v0 + v * (v1 - v0);
+}
+
+void AtlasRegion::Remap(float *texCoords, int count) const {
+    for(int i = 0; i < count; i++) {
+        texCoords[i * 2] = U(texCoords[i * 2]);
+        texCoords[i * 2 + 1] = V(texCoords[i * 2 + 1]);
+    }
+}
+
+TextureAtlas::TextureAtlas() : texture(0), width(0), height(0) {}
+
+std::string TextureAtlas::RegionName(const std::string &imageFile) {
+    size_t start = imageFile.find_last_of("/\\");
+    start = (start == std::string::npos) ? 0 : start + 1;
+    size_t end = imageFile.find_last_of('.');
+    if(end == std::string::npos || end < start) {
+        end = imageFile.size();
+    }
+    return imageFile.substr(start, end - start);
+}
+
+const AtlasRegion &TextureAtlas::Region(const std::string &name) const {
+    static const AtlasRegion missing;
+    std::map<std::string, AtlasRegion>::const_iterator it = regions.find(name);
+    if(it == regions.end()) {
+        printf("No region %s in the texture atlas\n", name.c_str());
+        return missing;
+    }
+    return it->second;
+}
+
+bool TextureAtlas::Load(const char *imageFile, const char *tableFile) {
+    std::ifstream infile(tableFile);
+    if(infile.fail()) {
+        return false;
+    }
+
+    // first line is "atlas <width> <height>", then "<name> <x> <y> <width> <height>" per region
+    std::string keyword;
+    infile >> keyword >> width >> height;
+    if(keyword != "atlas" || width <= 0 || height <= 0) {
+        printf("Bad texture atlas table: %s\n", tableFile);
+        return false;
+    }
+    regions.clear();
+    AtlasRegion region;
+    std::string name;
+    while(infile >> name >> region.x >> region.y >> region.width >> region.height) {
+        region.u0 = (float)region.x / (float)width;
+        region.v0 = (float)region.y / (float)height;
+        region.u1 = (float)(region.x + region.width) / (float)width;
+        region.v1 = (float)(region.y + region.height) / (float)height;
+        regions[name] = region;
+    }
+
+    int w, h, comp;
+    unsigned char *image = stbi_load(imageFile, &w, &h, &comp, STBI_rgb_alpha);
+    if(image == NULL || w != width || h != height) {
+        printf("Unable to load texture atlas image: %s\n", imageFile);
+        stbi_image_free(image);
+        return false;
+    }
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    stbi_image_free(image);
+    return true;
+}
+
+void TextureAtlas::Cleanup() {
+    glDeleteTextures(1, &texture);
+    texture = 0;
+    regions.clear();
+}
+
+static int NextPowerOfTwo(int value) {
+    int result = 1;
+    while(result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+struct CookImage {
+    std::string name;
+    int width, height;
+    unsigned char *pixels;
+    int x, y;
+};
+
+static bool TallerFirst(const CookImage *a, const CookImage *b) {
+    return a->height > b->height;
+}
+
+// rows left to right, a new shelf when the row is full. returns the height used
+static int PackShelves(std::vector<CookImage *> &images, int atlasWidth, int padding) {
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for(size_t i = 0; i < images.size(); i++) {
+        int paddedWidth = images[i]->width + padding * 2;
+        int paddedHeight = images[i]->height + padding * 2;
+        if(x + paddedWidth > atlasWidth) {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        images[i]->x = x + padding;
+        images[i]->y = y + padding;
+        x += paddedWidth;
+        shelfHeight = std::max(shelfHeight, paddedHeight);
+    }
+    return y + shelfHeight;
+}
+
+// uncompressed 32 bit TGA with a top left origin, stb_image loads it like the PNGs
+static bool WriteTGA(const char *filePath, const unsigned char *pixels, int width, int height) {
+    FILE *file = fopen(filePath, "wb");
+    if(file == NULL) {
+        return false;
+    }
+    unsigned char header[18] = { 0 };
+    header[2] = 2;
+    header[12] = width & 0xFF;
+    header[13] = (width >> 8) & 0xFF;
+    header[14] = height & 0xFF;
+    header[15] = (height >> 8) & 0xFF;
+    header[16] = 32;
+    header[17] = 0x28;
+    fwrite(header, 1, sizeof(header), file);
+    // TGA stores BGRA
+    std::vector<unsigned char> row(width * 4);
+    for(int y = 0; y < height; y++) {
+        const unsigned char *source = pixels + y * width * 4;
+        for(int x = 0; x < width; x++) {
+            row[x * 4] = source[x * 4 + 2];
+            row[x * 4 + 1] = source[x * 4 + 1];
+            row[x * 4 + 2] = source[x * 4];
+            row[x * 4 + 3] = source[x * 4 + 3];
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    fclose(file);
+    return true;
+}
+
+bool TextureAtlas::Cook(const std::vector<std::string> &imageFiles, const char *imageFile, const char *tableFile, int padding) {
+    std::vector<CookImage> images(imageFiles.size());
+    std::vector<CookImage *> order;
+    bool success = true;
+    int widest = 1;
+    int area = 0;
+    for(size_t i = 0; i < imageFiles.size(); i++) {
+        int comp;
+        images[i].name = RegionName(imageFiles[i]);
+        images[i].pixels = stbi_load(imageFiles[i].c_str(), &images[i].width, &images[i].height, &comp, STBI_rgb_alpha);
+        if(images[i].pixels == NULL) {
+            printf("Unable to load image for the texture atlas: %s\n", imageFiles[i].c_str());
+            success = false;
+            continue;
+        }
+        widest = std::max(widest, images[i].width + padding * 2);
+        area += (images[i].width + padding * 2) * (images[i].height + padding * 2);
+        order.push_back(&images[i]);
+    }
+
+    if(success) {
+        std::sort(order.begin(), order.end(), TallerFirst);
+
+        // smallest power of two width that packs about square
+        int atlasWidth = NextPowerOfTwo(widest);
+        while(atlasWidth * atlasWidth < area) {
+            atlasWidth *= 2;
+        }
+        int atlasHeight = NextPowerOfTwo(PackShelves(order, atlasWidth, padding));
+        while(atlasHeight > atlasWidth) {
+            atlasWidth *= 2;
+            atlasHeight = NextPowerOfTwo(PackShelves(order, atlasWidth, padding));
+        }
+
+        std::vector<unsigned char> atlas(atlasWidth * atlasHeight * 4, 0);
+        for(size_t i = 0; i < order.size(); i++) {
+            const CookImage &image = *order[i];
+            // copy with the edge pixels repeated out into the padding
+            for(int y = -padding; y < image.height + padding; y++) {
+                int sourceY = std::min(std::max(y, 0), image.height - 1);
+                for(int x = -padding; x < image.width + padding; x++) {
+                    int sourceX = std::min(std::max(x, 0), image.width - 1);
+                    const unsigned char *source = image.pixels + (sourceY * image.width + sourceX) * 4;
+                    unsigned char *destination = &atlas[((image.y + y) * atlasWidth + image.x + x) * 4];
+                    destination[0] = source[0];
+                    destination[1] = source[1];
+                    destination[2] = source[2];
+                    destination[3] = source[3];
+                }
+            }
+        }
+
+        std::ofstream table(tableFile);
+        if(table.fail() || !WriteTGA(imageFile, atlas.data(), atlasWidth, atlasHeight)) {
+            printf("Unable to write texture atlas: %s\n", imageFile);
+            success = false;
+        } else {
+            table << "atlas " << atlasWidth << " " << atlasHeight << "\n";
+            for(size_t i = 0; i < images.size(); i++) {
+                table << images[i].name << " " << images[i].x << " " << images[i].y << " " << images[i].width << " " << images[i].height << "\n";
+            }
+            printf("Cooked %d images into a %dx%d texture atlas\n", (int)images.size(), atlasWidth, atlasHeight);
+        }
+    }
+
+    for(size_t i = 0; i < images.size(); i++) {
+        stbi_image_free(images[i].pixels);
+    }
+    return success;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <string>
+#include <vector>
+#include <map>
+
+// where one source image ended up in the atlas. v runs down the image like the rest of the
+// codebase, so v0 is the top row
+class AtlasRegion {
+    public:
+
+        AtlasRegion();
+
+        int x, y;
+        int width, height;
+        float u0, v0, u1, v1;
+
+        // maps a coordinate in 0..1 over the source image into the atlas
+        float U(float u) const;
+        float V(float v) const;
+        // remaps count interleaved u,v pairs in place. the atlas can't repeat, so the
+        // coordinates have to stay in 0..1
+        void Remap(float *texCoords, int count) const;
+};
+
+// several images packed into one texture so a scene draws with a single bind.
+// Cook packs the images offline into a TGA (stb_image reads it back) and a text UV table,
+// Load reads both at runtime
+class TextureAtlas {
+    public:
+
+        TextureAtlas();
+
+        bool Load(const char *imageFile, const char *tableFile);
+        void Cleanup();
+
+        // region for an image by file name without folder and extension, "grass" for grass.png
+        const AtlasRegion &Region(const std::string &name) const;
+
+        // shelf packs the images with padding pixels of edge extrusion around each one, so linear
+        // filtering never picks up a neighbour
+        static bool Cook(const std::vector<std::string> &imageFiles, const char *imageFile, const char *tableFile, int padding = 2);
+        static std::string RegionName(const std::string &imageFile);
+
+        GLuint texture;
+        int width, height;
+        std::map<std::string, AtlasRegion> regions;
+};
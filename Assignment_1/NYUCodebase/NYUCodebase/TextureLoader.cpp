@@ -0,0 +1,222 @@
+#include "TextureLoader.h"
+#include "CookedTexture.h"
+#include "stb_image.h"
+#include <stdio.h>
+#include <string.h>
+
+TextureLoader::TextureLoader(int threadCount) : stopping(false) {
+    if(threadCount <= 0) {
+        threadCount = (int)std::thread::hardware_concurrency() - 1;
+        if(threadCount < 1) {
+            threadCount = 1;
+        }
+    }
+    for(int i = 0; i < threadCount; i++) {
+        workers.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+    }
+}
+
+TextureLoader::~TextureLoader() {
+    StopWorkers();
+}
+
+GLuint TextureLoader::Load(const std::string &filePath) {
+    // a cooked texture is only a map and a copy, nothing worth a worker
+    GLuint cooked = CookedTexture::Load(CookedTexture::CookedPath(filePath));
+    if(cooked != 0) {
+        textures.push_back(cooked);
+        return cooked;
+    }
+
+    // the name exists from the start so it can go straight into sprites, the storage comes later
+    GLuint texture;
+    glGenTextures(1, &texture);
+    textures.push_back(texture);
+    pending.insert(texture);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Job job;
+        job.filePath = filePath;
+        job.texture = texture;
+        jobs.push_back(job);
+    }
+    jobQueued.notify_one();
+    return texture;
+}
+
+void TextureLoader::WorkerLoop() {
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(!stopping && jobs.empty()) {
+                jobQueued.wait(lock);
+            }
+            if(stopping) {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        DecodedImage image;
+        int comp;
+        image.filePath = job.filePath;
+        image.texture = job.texture;
+        image.pixels = stbi_load(job.filePath.c_str(), &image.width, &image.height, &comp, STBI_rgb_alpha);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_back(image);
+        }
+        imageDecoded.notify_all();
+    }
+}
+
+void TextureLoader::Update(size_t uploadBudget) {
+    // everything staged by earlier Updates, its copy into the pixel buffer has had a frame to land
+    while(!staged.empty()) {
+        Upload(staged.front());
+        staged.pop_front();
+    }
+
+    size_t uploaded = 0;
+    while(uploaded < uploadBudget) {
+        DecodedImage image;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(decoded.empty()) {
+                return;
+            }
+            image = decoded.front();
+            decoded.pop_front();
+        }
+        if(image.pixels == NULL) {
+            printf("Unable to load image %s. Make sure the path is correct\n", image.filePath.c_str());
+            pending.erase(image.texture);
+            continue;
+        }
+        if(!Stage(image)) {
+            pending.erase(image.texture);
+        }
+        uploaded += (size_t)image.width * image.height * 4;
+        stbi_image_free(image.pixels);
+    }
+}
+
+bool TextureLoader::Stage(const DecodedImage &image) {
+#ifdef _WINDOWS
+    if(PixelBufferSupported()) {
+        GLuint pixelBuffer;
+        if(freePixelBuffers.empty()) {
+            glGenBuffers(1, &pixelBuffer);
+            pixelBuffers.push_back(pixelBuffer);
+        } else {
+            pixelBuffer = freePixelBuffers.back();
+            freePixelBuffers.pop_back();
+        }
+        GLsizeiptr size = (GLsizeiptr)image.width * image.height * 4;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        // orphan the storage of the buffer's last upload so the map doesn't wait for its transfer
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        void *mapped = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if(mapped != NULL) {
+            memcpy(mapped, image.pixels, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            StagedImage stagedImage;
+            stagedImage.texture = image.texture;
+            stagedImage.width = image.width;
+            stagedImage.height = image.height;
+            stagedImage.pixelBuffer = pixelBuffer;
+            staged.push_back(stagedImage);
+            return true;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        freePixelBuffers.push_back(pixelBuffer);
+    }
+#endif
+    SetFilters(image.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+    return false;
+}
+
+void TextureLoader::Upload(const StagedImage &image) {
+#ifdef _WINDOWS
+    SetFilters(image.texture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, image.pixelBuffer);
+    // reads from the bound buffer, the driver copies to the texture without holding us up
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    freePixelBuffers.push_back(image.pixelBuffer);
+#endif
+    pending.erase(image.texture);
+}
+
+void TextureLoader::SetFilters(GLuint texture) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void TextureLoader::Finish() {
+    while(!pending.empty()) {
+        {
+            // staged images only need another Update, decoded ones may still be on the workers
+            std::unique_lock<std::mutex> lock(mutex);
+            while(staged.empty() && decoded.empty()) {
+                imageDecoded.wait(lock);
+            }
+        }
+        Update((size_t)-1);
+    }
+}
+
+bool TextureLoader::IsReady(GLuint texture) const {
+    return pending.find(texture) == pending.end();
+}
+
+bool TextureLoader::Done() const {
+    return pending.empty();
+}
+
+void TextureLoader::StopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobQueued.notify_all();
+    for(size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    workers.clear();
+    for(size_t i = 0; i < decoded.size(); i++) {
+        stbi_image_free(decoded[i].pixels);
+    }
+    decoded.clear();
+    jobs.clear();
+}
+
+void TextureLoader::Cleanup() {
+    StopWorkers();
+    if(!textures.empty()) {
+        glDeleteTextures((GLsizei)textures.size(), textures.data());
+        textures.clear();
+    }
+    pending.clear();
+    staged.clear();
+#ifdef _WINDOWS
+    if(!pixelBuffers.empty()) {
+        glDeleteBuffers((GLsizei)pixelBuffers.size(), pixelBuffers.data());
+    }
+#endif
+    pixelBuffers.clear();
+    freePixelBuffers.clear();
+}
+
+bool TextureLoader::PixelBufferSupported() {
+#ifdef _WINDOWS
+    return GLEW_ARB_pixel_buffer_object != 0;
+#else
+    return false;
+#endif
+}
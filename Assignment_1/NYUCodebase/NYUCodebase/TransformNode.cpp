@@ -0,0 +1,92 @@
+
+#include "TransformNode.h"
+#include <algorithm>
+
+TransformNode::TransformNode() : parent(nullptr), dirty(true), worldVersion(0) {}
+
+TransformNode::~TransformNode() {
+    if(parent) {
+        parent->RemoveChild(this);
+    }
+    for(size_t i = 0; i < children.size(); i++) {
+        children[i]->parent = nullptr;
+        children[i]->MarkDirty();
+    }
+}
+
+void TransformNode::SetParent(TransformNode *newParent) {
+    if(parent == newParent) {
+        return;
+    }
+    if(parent) {
+        parent->RemoveChild(this);
+    }
+    if(newParent) {
+        newParent->AddChild(this);
+    }
+}
+
+void TransformNode::AddChild(TransformNode *child) {
+    if(child->parent == this) {
+        return;
+    }
+    if(child->parent) {
+        child->parent->RemoveChild(child);
+    }
+    child->parent = this;
+    children.push_back(child);
+    child->MarkDirty();
+}
+
+void TransformNode::RemoveChild(TransformNode *child) {
+    std::vector<TransformNode *>::iterator it = std::find(children.begin(), children.end(), child);
+    if(it == children.end()) {
+        return;
+    }
+    children.erase(it);
+    child->parent = nullptr;
+    child->MarkDirty();
+}
+
+void TransformNode::SetLocalMatrix(const Matrix &matrix) {
+    localMatrix = matrix;
+    MarkDirty();
+}
+
+void TransformNode::SetPosition(float x, float y, float z) {
+    localMatrix.SetPosition(x, y, z);
+    MarkDirty();
+}
+
+void TransformNode::Translate(float x, float y, float z) {
+    localMatrix.Translate(x, y, z);
+    MarkDirty();
+}
+
+const Matrix &TransformNode::GetLocalMatrix() const {
+    return localMatrix;
+}
+
+const Matrix &TransformNode::GetWorldMatrix() {
+    if(dirty) {
+        if(parent) {
+            worldMatrix = localMatrix * parent->GetWorldMatrix();
+        } else {
+            worldMatrix = localMatrix;
+        }
+        dirty = false;
+        worldVersion++;
+    }
+    return worldMatrix;
+}
+
+void TransformNode::MarkDirty() {
+    // a dirty node's children were already marked when it was, so stop there
+    if(dirty) {
+        return;
+    }
+    dirty = true;
+    for(size_t i = 0; i < children.size(); i++) {
+        children[i]->MarkDirty();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+
+// Node in a parent/child transform tree. The world matrix is cached and only
+// recomputed when this node or one of its ancestors changed since the last
+// GetWorldMatrix(), so static UI and level geometry cost nothing per frame.
+// Nodes don't own each other, a node detaches itself from the tree when destroyed.
+class TransformNode {
+    public:
+    
+        TransformNode();
+        ~TransformNode();
+    
+        TransformNode(const TransformNode &) = delete;
+        TransformNode &operator = (const TransformNode &) = delete;
+    
+        void SetParent(TransformNode *newParent);
+        void AddChild(TransformNode *child);
+        void RemoveChild(TransformNode *child);
+    
+        void SetLocalMatrix(const Matrix &matrix);
+        void SetPosition(float x, float y, float z);
+        void Translate(float x, float y, float z);
+    
+        const Matrix &GetLocalMatrix() const;
+        const Matrix &GetWorldMatrix();
+    
+        // marks this node and everything under it for recompute
+        void MarkDirty();
+    
+        TransformNode *parent;
+        std::vector<TransformNode *> children;
+    
+        Matrix localMatrix;
+        Matrix worldMatrix;
+        bool dirty;
+    
+        // bumped every time worldMatrix is recomputed, compare against a saved
+        // value to skip re-uploading a model matrix that didn't change
+        unsigned int worldVersion;
+};
@@ -0,0 +1,113 @@
+#include "VertexLayout.h"
+
+GLuint VertexLayout::boundVertexArray = 0;
+unsigned long long VertexLayout::skippedBinds = 0;
+
+VertexLayout::VertexLayout() : vertexArray(0), enabled(false) {}
+
+void VertexLayout::Add(GLint location, GLint components, GLenum type, bool normalized, GLsizei stride, GLuint divisor) {
+    VertexAttribute attribute = { location, components, type, (GLboolean)normalized, stride, divisor };
+    attributes.push_back(attribute);
+}
+
+bool VertexLayout::Bind(bool clientArrays) {
+#ifdef _WINDOWS
+    if(Supported() && !clientArrays) {
+        if(vertexArray == 0) {
+            // enabled once for good, the VAO remembers it along with the divisors
+            glGenVertexArrays(1, &vertexArray);
+            glBindVertexArray(vertexArray);
+            boundVertexArray = vertexArray;
+            for(size_t i = 0; i < attributes.size(); i++) {
+                if(attributes[i].location < 0) {
+                    continue;
+                }
+                glEnableVertexAttribArray(attributes[i].location);
+                if(attributes[i].divisor != 0) {
+                    glVertexAttribDivisorARB(attributes[i].location, attributes[i].divisor);
+                }
+            }
+            return false;
+        }
+        if(boundVertexArray == vertexArray) {
+            skippedBinds++;
+        } else {
+            glBindVertexArray(vertexArray);
+            boundVertexArray = vertexArray;
+        }
+        return true;
+    }
+    BindNone();
+#else
+    (void)clientArrays;
+#endif
+    enabled = true;
+    for(size_t i = 0; i < attributes.size(); i++) {
+        if(attributes[i].location < 0) {
+            continue;
+        }
+        glEnableVertexAttribArray(attributes[i].location);
+#ifdef _WINDOWS
+        if(attributes[i].divisor != 0) {
+            glVertexAttribDivisorARB(attributes[i].location, attributes[i].divisor);
+        }
+#endif
+    }
+    return false;
+}
+
+void VertexLayout::Pointer(int attribute, const void *data) {
+    const VertexAttribute &a = attributes[attribute];
+    if(a.location >= 0) {
+        glVertexAttribPointer(a.location, a.components, a.type, a.normalized, a.stride, data);
+    }
+}
+
+void VertexLayout::Unbind() {
+    if(!enabled) {
+        return;
+    }
+    enabled = false;
+    for(size_t i = 0; i < attributes.size(); i++) {
+        if(attributes[i].location < 0) {
+            continue;
+        }
+#ifdef _WINDOWS
+        if(attributes[i].divisor != 0) {
+            // the next format may read this attribute per vertex
+            glVertexAttribDivisorARB(attributes[i].location, 0);
+        }
+#endif
+        glDisableVertexAttribArray(attributes[i].location);
+    }
+}
+
+void VertexLayout::Cleanup() {
+#ifdef _WINDOWS
+    if(vertexArray != 0) {
+        if(boundVertexArray == vertexArray) {
+            glBindVertexArray(0);
+            boundVertexArray = 0;
+        }
+        glDeleteVertexArrays(1, &vertexArray);
+    }
+#endif
+    vertexArray = 0;
+}
+
+bool VertexLayout::Supported() {
+#ifdef _WINDOWS
+    return GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object;
+#else
+    return false;
+#endif
+}
+
+void VertexLayout::BindNone() {
+#ifdef _WINDOWS
+    if(boundVertexArray != 0) {
+        glBindVertexArray(0);
+        boundVertexArray = 0;
+    }
+#endif
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#ifdef _WINDOWS
+	#include <GL/glew.h>
+#endif
+#include <SDL_opengl.h>
+#include <stddef.h>
+#include <vector>
+
+struct VertexAttribute {
+    // -1 when the program doesn't have it, every call on it is skipped
+    GLint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    GLuint divisor;
+};
+
+// one vertex format: which attributes it reads, their sizes and types, and which step per instance.
+// With vertex array objects all of that is set up once in a VAO and Bind is a single
+// glBindVertexArray, so the draws only point the attributes at this frame's data:
+//
+//  program->layout.Bind(!ring.Reserve(sizeof(vertices) + sizeof(texCoords), 2));
+//  program->layout.Pointer(0, ring.Stream(vertices, sizeof(vertices)));
+//  program->layout.Pointer(1, ring.Stream(texCoords, sizeof(texCoords)));
+//  QuadIndexBuffer::Shared().Draw(1, 4 * sizeof(float));
+//  program->layout.Unbind();
+//
+// Without them, or for data in client memory, which a VAO can't point at, Bind and Unbind enable
+// and disable the attributes like the draws used to. Once layouts are in use every draw has to go
+// through one, the VAO a layout leaves bound is its own and enabling attributes by hand would change it
+class VertexLayout {
+    public:
+
+        // nothing is created until the first Bind, so layouts can be built before there's a context
+        VertexLayout();
+
+        // attributes are numbered in the order they're added, Pointer takes that number
+        void Add(GLint location, GLint components, GLenum type, bool normalized = false, GLsizei stride = 0, GLuint divisor = 0);
+
+        // clientArrays when any of the draw's data is in client memory instead of a buffer.
+        // returns true when the attributes still point where the last draw with this layout left
+        // them, so data that never moves, like a static quad, only needs pointing when it's false
+        bool Bind(bool clientArrays = false);
+        // data is what glVertexAttribPointer would take, an offset into the bound array buffer or a client pointer
+        void Pointer(int attribute, const void *data);
+        // disables the attributes again without VAOs, nothing with them
+        void Unbind();
+        void Cleanup();
+
+        static bool Supported();
+        // back to no vertex array, for code that enables attributes by hand
+        static void BindNone();
+
+        std::vector<VertexAttribute> attributes;
+        GLuint vertexArray;
+        // the last Bind enabled the attributes by hand, Unbind disables them
+        bool enabled;
+
+        // vertex array bound through Bind, 0 when none or without VAOs
+        static GLuint boundVertexArray;
+        // glBindVertexArray calls skipped because the layout was already bound
+        static unsigned long long skippedBinds;
+};
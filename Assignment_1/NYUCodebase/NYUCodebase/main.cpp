@@ -7,7 +7,10 @@
 #include <SDL_image.h>
 #include "ShaderProgram.h"
 #include "Matrix.h"
+#include "TextureAtlas.h"
+#include "VertexRing.h"
 #include "stb_image.h"
+#include <string.h>
 
 
 #ifdef _WINDOWS
@@ -19,6 +22,9 @@
 
 SDL_Window* displayWindow;
 
+//Every frame's vertices are streamed through this instead of being copied out of client arrays by the driver
+VertexRing vertexRing;
+
 GLuint LoadTexture(const char *filePath) {
 	int w, h, comp;
 	unsigned char* image = stbi_load(filePath, &w, &h, &comp, STBI_rgb_alpha);
@@ -38,6 +44,19 @@ GLuint LoadTexture(const char *filePath) {
 
 int main(int argc, char *argv[])
 {
+	//Images packed into the scene atlas, --cook-atlas [image.png ...] repacks it and exits
+	std::vector<std::string> atlasImages;
+	atlasImages.push_back(RESOURCE_FOLDER"grass.png");
+	atlasImages.push_back(RESOURCE_FOLDER"star.png");
+	atlasImages.push_back(RESOURCE_FOLDER"rpgTile155.png");
+	atlasImages.push_back(RESOURCE_FOLDER"cactus.png");
+	if (argc > 1 && strcmp(argv[1], "--cook-atlas") == 0) {
+		if (argc > 2) {
+			atlasImages.assign(argv + 2, argv + argc);
+		}
+		return TextureAtlas::Cook(atlasImages, RESOURCE_FOLDER"atlas.tga", RESOURCE_FOLDER"atlas.txt") ? 0 : 1;
+	}
+
 	SDL_Init(SDL_INIT_VIDEO);
 
 	displayWindow = SDL_CreateWindow("Assignment 1", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640, 360, SDL_WINDOW_OPENGL);
@@ -53,11 +72,45 @@ int main(int argc, char *argv[])
 
 	//Load the shader program
 	ShaderProgram program;
-	program.Load(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
-	GLuint grass = LoadTexture(RESOURCE_FOLDER"grass.png");
-	GLuint sun = LoadTexture(RESOURCE_FOLDER"star.png");
-	GLuint bush = LoadTexture(RESOURCE_FOLDER"rpgTile155.png");
-	GLuint cactus = LoadTexture(RESOURCE_FOLDER"cactus.png");
+	program.Submit(RESOURCE_FOLDER"vertex_textured.glsl", RESOURCE_FOLDER"fragment_textured.glsl");
+	//Compiles in the background, it gets finished the first time the program is used
+
+	//Every texture in the scene comes out of one atlas
+	TextureAtlas atlas;
+	if (!atlas.Load(RESOURCE_FOLDER"atlas.tga", RESOURCE_FOLDER"atlas.txt")) {
+		//Not cooked yet, pack it now
+		TextureAtlas::Cook(atlasImages, RESOURCE_FOLDER"atlas.tga", RESOURCE_FOLDER"atlas.txt");
+		atlas.Load(RESOURCE_FOLDER"atlas.tga", RESOURCE_FOLDER"atlas.txt");
+	}
+	const AtlasRegion &grass = atlas.Region("grass");
+	const AtlasRegion &sun = atlas.Region("star");
+	const AtlasRegion &bush = atlas.Region("rpgTile155");
+	const AtlasRegion &cactus = atlas.Region("cactus");
+
+	//The atlas can't repeat the grass, so the ground is one quad per tile
+	float groundVertices[4 * 12];
+	float groundTexCoords[4 * 12];
+	int groundTiles = 0;
+	for (float u = 0.0f; u < 3.55f; u += 1.0f) {
+		float tileWidth = (3.55f - u < 1.0f) ? 3.55f - u : 1.0f;
+		float right = 3.55f - u * 2.0f;
+		float left = right - tileWidth * 2.0f;
+		float tileVertices[] = { right, -1.0, left, -1.0, left, -2.0,
+								 right, -1.0, left, -2.0, right, -2.0 };
+		float tileTexCoords[] = {
+			0.0, 0.0,
+			tileWidth, 0.0,
+			tileWidth, 1.0,
+
+			0.0, 0.0,
+			tileWidth, 1.0,
+			0.0, 1.0
+		};
+		grass.Remap(tileTexCoords, 6);
+		memcpy(groundVertices + groundTiles * 12, tileVertices, sizeof(tileVertices));
+		memcpy(groundTexCoords + groundTiles * 12, tileTexCoords, sizeof(tileTexCoords));
+		groundTiles++;
+	}
 
 	//Load the matrices
 	Matrix projectionMatrix;
@@ -69,11 +122,14 @@ int main(int argc, char *argv[])
 	projectionMatrix.SetOrthoProjection(-3.55f, 3.55f, -2.0f, 2.0f, -1.0f, 1.0f);
 
 	//Use the specified program ID
-	glUseProgram(program.programID);
+	program.Use();
 
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+	//The only texture bind for the whole scene
+	glBindTexture(GL_TEXTURE_2D, atlas.texture);
+
 	float lastFrameTicks = 0.0;
 	float dist = 0.0;
 	program.SetColor(0.8f, 0.8f, 0.6f, 1.0f);
@@ -100,8 +156,6 @@ int main(int argc, char *argv[])
 		program.SetProjectionMatrix(projectionMatrix);
 		program.SetViewMatrix(viewMatrix);
 
-		glBindTexture(GL_TEXTURE_2D, cactus);
-
 		//Define an array of vertex data
 		float treeVertices[] = {
 			-3.0, -1.0, //bottom left
@@ -111,8 +165,6 @@ int main(int argc, char *argv[])
 			-3.0, 0.8, //top left
 			-3.0, -1.0  //bottom left
 		};
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, treeVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
 
 		float treeTexCoords[] = {
 			0.0, 1.0, //bottom left
@@ -122,37 +174,25 @@ int main(int argc, char *argv[])
 			0.0, 0.0, //top left
 			0.0, 1.0 //bottom left
 		};
-		glVertexAttribPointer(program.texCoordAttribute, 2, GL_FLOAT, false, 0, treeTexCoords);
-		glEnableVertexAttribArray(program.texCoordAttribute);
+		cactus.Remap(treeTexCoords, 6);
+		program.layout.Bind(!vertexRing.Reserve(sizeof(treeVertices) + sizeof(treeTexCoords), 2));
+		program.layout.Pointer(0, vertexRing.Stream(treeVertices, sizeof(treeVertices)));
+		program.layout.Pointer(1, vertexRing.Stream(treeTexCoords, sizeof(treeTexCoords)));
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program.positionAttribute);
-		glDisableVertexAttribArray(program.texCoordAttribute);
-
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
-		glBindTexture(GL_TEXTURE_2D, grass);
 
-		float groundVertices[] = { 3.55, -1.0, -3.55, -1.0, -3.55, -2.0,
-								   3.55, -1.0, -3.55, -2.0, 3.55, -2.0 };
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, groundVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
-		float groundTexCoords[] = {
-			0.0, -1.0,
-			3.55, -1.0,
-			3.55, 0.0,
-
-			0.0, -1.0,
-			3.55, 0.0,
-			0.0, 0.0
-		};
-		glVertexAttribPointer(program.texCoordAttribute, 2, GL_FLOAT, false, 0, groundTexCoords);
-		glEnableVertexAttribArray(program.texCoordAttribute);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(program.positionAttribute);
-		glDisableVertexAttribArray(program.texCoordAttribute);
+		size_t groundBytes = groundTiles * 12 * sizeof(float);
+		program.layout.Bind(!vertexRing.Reserve(2 * groundBytes, 2));
+		program.layout.Pointer(0, vertexRing.Stream(groundVertices, groundBytes));
+		program.layout.Pointer(1, vertexRing.Stream(groundTexCoords, groundBytes));
+		glDrawArrays(GL_TRIANGLES, 0, groundTiles * 6);
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
 		//CREATING THE SUN
 		sunModelMatrix.Identity();
-		glBindTexture(GL_TEXTURE_2D, sun);
 		sunModelMatrix.Translate(-2.0, 0.0, 0.0);
 		sunModelMatrix.Translate(dist, 0.0, 0.0);
 		if (dist > 2.0) { 
@@ -165,31 +205,30 @@ int main(int argc, char *argv[])
 
 		float sunVertices[] = { 3.0, 1.5, 3.0, 2.0, 2.5, 1.5,
 								3.0, 2.0, 2.5, 2.0, 2.5, 1.5 };
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, sunVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
 		
 		float sunTexCoords[] = {
-			1.0, -1.0, //bottom right
-			1.0, 0.0, //top right
-			0.0, -1.0, //bottom left
+			1.0, 0.0, //bottom right
+			1.0, 1.0, //top right
+			0.0, 0.0, //bottom left
 			
-			1.0, 0.0, //top right
-			0.0, 0.0,  //top left
-			0.0, -1.0 //bottom left
+			1.0, 1.0, //top right
+			0.0, 1.0,  //top left
+			0.0, 0.0 //bottom left
 		};
+		sun.Remap(sunTexCoords, 6);
 
-		glVertexAttribPointer(program.texCoordAttribute, 2, GL_FLOAT, false, 0, sunTexCoords);
-		glEnableVertexAttribArray(program.texCoordAttribute);
+		program.layout.Bind(!vertexRing.Reserve(sizeof(sunVertices) + sizeof(sunTexCoords), 2));
+		program.layout.Pointer(0, vertexRing.Stream(sunVertices, sizeof(sunVertices)));
+		program.layout.Pointer(1, vertexRing.Stream(sunTexCoords, sizeof(sunTexCoords)));
 		
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 		
-		glDisableVertexAttribArray(program.positionAttribute);
-		glDisableVertexAttribArray(program.texCoordAttribute);
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
 
 
 		//CREATING THE BUSH
-		glBindTexture(GL_TEXTURE_2D, bush);
 
 		float bushVertices[] = { 
 			-1.0, -1.0, //bottom right
@@ -199,8 +238,6 @@ int main(int argc, char *argv[])
 			-1.0, -0.5, //top right
 			-1.0, -1.0  //bottom right
 		};
-		glVertexAttribPointer(program.positionAttribute, 2, GL_FLOAT, false, 0, bushVertices);
-		glEnableVertexAttribArray(program.positionAttribute);
 
 		float bushTexCoords[] = { 
 			1.0, 1.0, //bottom right
@@ -210,18 +247,24 @@ int main(int argc, char *argv[])
 			1.0, 0.0,  //top right
 			1.0, 1.0  //bottom right
 		};
-		glVertexAttribPointer(program.texCoordAttribute, 2, GL_FLOAT, false, 0, bushTexCoords);
-		glEnableVertexAttribArray(program.texCoordAttribute);
+		bush.Remap(bushTexCoords, 6);
+		program.layout.Bind(!vertexRing.Reserve(sizeof(bushVertices) + sizeof(bushTexCoords), 2));
+		program.layout.Pointer(0, vertexRing.Stream(bushVertices, sizeof(bushVertices)));
+		program.layout.Pointer(1, vertexRing.Stream(bushTexCoords, sizeof(bushTexCoords)));
 
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 
-		glDisableVertexAttribArray(program.positionAttribute);
-		glDisableVertexAttribArray(program.texCoordAttribute);
+		program.layout.Unbind();
+		vertexRing.Unbind();
 
 
 		SDL_GL_SwapWindow(displayWindow);
+		//Next frame writes to the next region of the ring
+		vertexRing.EndFrame();
 	}
 
+	vertexRing.Cleanup();
+	atlas.Cleanup();
 	SDL_Quit();
 	return 0;
 }
@@ -332,6 +332,11 @@ publish, and distribute this file as you see fit.
 // STBI_JPEG_OLD, but this will disable some of the SIMD decoding path
 // and hence cost some performance.
 //
+// PNG unfiltering (Sub, Up, Average and Paeth on 8-bit RGB and RGBA rows)
+// and the expansion of gray and gray+alpha images to RGBA also have SSE2
+// paths. They give the same bytes as the scalar code; call
+// stbi_set_png_simd(0) to force the scalar code, e.g. to compare the two.
+//
 // If for some reason you do not want to use any of SIMD code, or if
 // you have issues compiling it, you can disable it entirely by
 // defining STBI_NO_SIMD.
@@ -502,6 +507,9 @@ STBIDEF void stbi_convert_iphone_png_to_rgb(int flag_true_if_should_convert);
 // flip the image vertically, so the first pixel in the output array is the bottom left
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
+// use the SSE2 PNG unfilter and RGBA expansion paths when the CPU has SSE2 (default on)
+STBIDEF void stbi_set_png_simd(int flag_true_if_should_use_simd);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -1338,6 +1346,53 @@ static stbi_uc stbi__compute_y(int r, int g, int b)
    return (stbi_uc) (((r*77) + (g*150) +  (29*b)) >> 8);
 }
 
+static int stbi__png_simd = 1;
+
+STBIDEF void stbi_set_png_simd(int flag_true_if_should_use_simd)
+{
+   stbi__png_simd = flag_true_if_should_use_simd;
+}
+
+#ifdef STBI_SSE2
+static int stbi__png_simd_enabled(void)
+{
+   static int available = -1;
+   if (available < 0) available = stbi__sse2_available();
+   return stbi__png_simd && available;
+}
+
+// gray (img_n 1) or gray+alpha (img_n 2) to RGBA, 16 or 8 pixels per iteration
+static void stbi__gray_to_rgba_sse2(stbi_uc *src, stbi_uc *dest, int count, int img_n)
+{
+   int i = 0;
+   if (img_n == 1) {
+      __m128i opaque = _mm_set1_epi8((char) 255);
+      for (; i + 16 <= count; i += 16) {
+         __m128i g = _mm_loadu_si128((__m128i *) (src + i));
+         __m128i gg_lo = _mm_unpacklo_epi8(g, g), gg_hi = _mm_unpackhi_epi8(g, g);
+         __m128i ga_lo = _mm_unpacklo_epi8(g, opaque), ga_hi = _mm_unpackhi_epi8(g, opaque);
+         _mm_storeu_si128((__m128i *) (dest + i*4     ), _mm_unpacklo_epi16(gg_lo, ga_lo));
+         _mm_storeu_si128((__m128i *) (dest + i*4 + 16), _mm_unpackhi_epi16(gg_lo, ga_lo));
+         _mm_storeu_si128((__m128i *) (dest + i*4 + 32), _mm_unpacklo_epi16(gg_hi, ga_hi));
+         _mm_storeu_si128((__m128i *) (dest + i*4 + 48), _mm_unpackhi_epi16(gg_hi, ga_hi));
+      }
+      for (; i < count; ++i)
+         dest[i*4]=dest[i*4+1]=dest[i*4+2]=src[i], dest[i*4+3]=255;
+   } else {
+      __m128i low = _mm_set1_epi16(0xff);
+      for (; i + 8 <= count; i += 8) {
+         __m128i ga = _mm_loadu_si128((__m128i *) (src + i*2));
+         __m128i g = _mm_and_si128(ga, low);
+         __m128i gg = _mm_or_si128(g, _mm_slli_epi16(g, 8));
+         _mm_storeu_si128((__m128i *) (dest + i*4     ), _mm_unpacklo_epi16(gg, ga));
+         _mm_storeu_si128((__m128i *) (dest + i*4 + 16), _mm_unpackhi_epi16(gg, ga));
+      }
+      for (; i < count; ++i)
+         dest[i*4]=dest[i*4+1]=dest[i*4+2]=src[i*2], dest[i*4+3]=src[i*2+1];
+   }
+}
+#endif
+
 static unsigned char *stbi__convert_format(unsigned char *data, int img_n, int req_comp, unsigned int x, unsigned int y)
 {
    int i,j;
@@ -1356,6 +1411,13 @@ static unsigned char *stbi__convert_format(unsigned char *data, int img_n, int r
       unsigned char *src  = data + j * x * img_n   ;
       unsigned char *dest = good + j * x * req_comp;
 
+      #ifdef STBI_SSE2
+      if (req_comp == 4 && img_n <= 2 && stbi__png_simd_enabled()) {
+         stbi__gray_to_rgba_sse2(src, dest, x, img_n);
+         continue;
+      }
+      #endif
+
       #define COMBO(a,b)  ((a)*8+(b))
       #define CASE(a,b)   case COMBO(a,b): for(i=x-1; i >= 0; --i, src += a, dest += b)
       // convert source image with img_n components to one with req_comp components;
@@ -4001,6 +4063,91 @@ static int stbi__paeth(int a, int b, int c)
 
 static stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+#ifdef STBI_SSE2
+// one 8-bit RGB or RGBA pixel widened to 16-bit lanes
+static __m128i stbi__png_pixel_sse2(stbi_uc *p, int n)
+{
+   stbi__uint32 v;
+   if (n == 4) memcpy(&v, p, 4);
+   else v = p[0] | (p[1] << 8) | ((stbi__uint32) p[2] << 16); // don't read past the end of raw
+   return _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) v), _mm_setzero_si128());
+}
+
+static __m128i stbi__abs_epi16_sse2(__m128i v)
+{
+   return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+static __m128i stbi__select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Up on any row: plain bytewise add, 16 bytes at a time
+static void stbi__png_up_sse2(stbi_uc *cur, stbi_uc *prior, stbi_uc *raw, int n)
+{
+   int k = 0;
+   for (; k + 16 <= n; k += 16) {
+      __m128i r = _mm_loadu_si128((__m128i *) (raw + k));
+      __m128i b = _mm_loadu_si128((__m128i *) (prior + k));
+      _mm_storeu_si128((__m128i *) (cur + k), _mm_add_epi8(r, b));
+   }
+   for (; k < n; ++k)
+      cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+}
+
+// unfilters count pixels of an 8-bit RGB (img_n 3) or RGBA (img_n 4) row into 4 byte output
+// pixels, setting alpha to 255 for RGB. Sub/Avg/Paeth depend on the pixel to the left, so this
+// goes a pixel at a time with the channels side by side. the pixel before cur must be done
+static void stbi__png_unfilter_sse2(stbi_uc *cur, stbi_uc *prior, stbi_uc *raw, int count, int filter, int img_n)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i a = stbi__png_pixel_sse2(cur - 4, 4);
+   __m128i b, c, pred, pa, pb, pc, smallest;
+   stbi__uint32 alpha = img_n == 3 ? 0xff000000u : 0, v;
+   int i;
+
+   // prior only exists past the first row, where avg/paeth can show up
+   c = (filter == STBI__F_avg || filter == STBI__F_paeth) ? stbi__png_pixel_sse2(prior - 4, 4) : zero;
+   for (i=0; i < count; ++i, raw += img_n, cur += 4, prior += 4) {
+      switch (filter) {
+         case STBI__F_sub:
+         case STBI__F_paeth_first: // paeth(a,0,0) is always a
+            pred = a;
+            break;
+         case STBI__F_up:
+            pred = stbi__png_pixel_sse2(prior, 4);
+            break;
+         case STBI__F_avg:
+            pred = _mm_srli_epi16(_mm_add_epi16(a, stbi__png_pixel_sse2(prior, 4)), 1);
+            break;
+         case STBI__F_avg_first:
+            pred = _mm_srli_epi16(a, 1);
+            break;
+         case STBI__F_paeth:
+            b = stbi__png_pixel_sse2(prior, 4);
+            pa = _mm_sub_epi16(b, c);
+            pb = _mm_sub_epi16(a, c);
+            pc = stbi__abs_epi16_sse2(_mm_add_epi16(pa, pb));
+            pa = stbi__abs_epi16_sse2(pa);
+            pb = stbi__abs_epi16_sse2(pb);
+            smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            pred = stbi__select_sse2(_mm_cmpeq_epi16(smallest, pa), a,
+                   stbi__select_sse2(_mm_cmpeq_epi16(smallest, pb), b, c));
+            c = b;
+            break;
+         default:
+            pred = zero;
+            break;
+      }
+      a = _mm_add_epi8(_mm_packus_epi16(stbi__png_pixel_sse2(raw, img_n), zero), _mm_packus_epi16(pred, zero));
+      v = (stbi__uint32) _mm_cvtsi128_si32(a) | alpha;
+      memcpy(cur, &v, 4);
+      a = _mm_unpacklo_epi8(a, zero);
+   }
+}
+#endif
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4081,6 +4228,16 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
       // this is a little gross, so that we don't switch per-pixel or per-component
       if (depth < 8 || img_n == out_n) {
          int nk = (width - 1)*filter_bytes;
+         #ifdef STBI_SSE2
+         if ((filter == STBI__F_up || (depth == 8 && filter_bytes == 4 && filter != STBI__F_none)) && stbi__png_simd_enabled()) {
+            if (filter == STBI__F_up)
+               stbi__png_up_sse2(cur, prior, raw, nk);
+            else
+               stbi__png_unfilter_sse2(cur, prior, raw, width - 1, filter, 4);
+            raw += nk;
+            continue;
+         }
+         #endif
          #define CASE(f) \
              case f:     \
                 for (k=0; k < nk; ++k)
@@ -4098,6 +4255,13 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
          raw += nk;
       } else {
          STBI_ASSERT(img_n+1 == out_n);
+         #ifdef STBI_SSE2
+         if (depth == 8 && img_n == 3 && stbi__png_simd_enabled()) {
+            stbi__png_unfilter_sse2(cur, prior, raw, x - 1, filter, 3);
+            raw += (x - 1) * 3;
+            continue;
+         }
+         #endif
          #define CASE(f) \
              case f:     \
                 for (i=x-1; i >= 1; --i, cur[filter_bytes]=255,raw+=filter_bytes,cur+=output_bytes,prior+=output_bytes) \
@@ -4324,12 +4488,9 @@ static int stbi__expand_png_palette(stbi__png *a, stbi_uc *palette, int len, int
          p += 3;
       }
    } else {
+      // one 4 byte copy per pixel instead of four byte copies
       for (i=0; i < pixel_count; ++i) {
-         int n = orig[i]*4;
-         p[0] = palette[n  ];
-         p[1] = palette[n+1];
-         p[2] = palette[n+2];
-         p[3] = palette[n+3];
+         memcpy(p, palette + orig[i]*4, 4);
          p += 4;
       }
    }